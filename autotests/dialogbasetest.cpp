@@ -0,0 +1,205 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include <qtest.h>
+#include <qlabel.h>
+#include <qlayout.h>
+#include <qstandardpaths.h>
+#include <qpushbutton.h>
+#include <qpixmap.h>
+
+#include <kconfiggroup.h>
+#include <kguiitem.h>
+#include <ksharedconfig.h>
+
+#include "dialogbase.h"
+#include "dialogstatesaver.h"
+
+
+// Tests for the layout passes and resize events done by DialogBase.
+// The counts are reported, so that the test output shows the figures
+// for a dialog being shown with and without a saved size.
+
+class TestDialog : public DialogBase
+{
+    Q_OBJECT
+
+public:
+    explicit TestDialog(QWidget *pnt = nullptr)
+        : DialogBase(pnt)
+    {
+        setObjectName("DialogBaseTestDialog");
+        mLabel = new QLabel("A label for the test dialog", this);
+        setMainWidget(mLabel);
+        setButtons(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
+    }
+
+    QLabel *label() const				{ return (mLabel); }
+
+private:
+    QLabel *mLabel;
+};
+
+
+class DialogBaseTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void testShow_data();
+    void testShow();
+    void testNoChange();
+    void testChange();
+    void testButtonItems();
+};
+
+
+static void deleteSavedState()
+{
+    KConfigGroup grp = KSharedConfig::openConfig(QString(), KConfig::NoCascade)->group("DialogBaseTestDialog");
+    grp.deleteGroup();
+    grp.sync();
+}
+
+
+void DialogBaseTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+
+void DialogBaseTest::init()
+{
+    deleteSavedState();
+}
+
+
+void DialogBaseTest::testShow_data()
+{
+    QTest::addColumn<bool>("saved");
+    QTest::newRow("no saved size") << false;
+    QTest::newRow("saved size") << true;
+}
+
+
+void DialogBaseTest::testShow()
+{
+    QFETCH(bool, saved);
+    if (saved)
+    {
+        TestDialog dlg;
+        dlg.resize(dlg.sizeHint()+QSize(100, 50));
+        DialogStateSaver::saveWindowState(&dlg);
+    }
+
+    TestDialog dlg;
+    dlg.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&dlg));
+    QTest::qWait(50);					// for any pending layout requests
+
+    qDebug() << "layout passes" << dlg.layoutPassCount() << "resize events" << dlg.resizeEventCount();
+
+    // The layout and size are set up before the dialog is shown,
+    // so it should be laid out once and not resized after that.
+    QCOMPARE(dlg.layoutPassCount(), 1);
+    QVERIFY(dlg.resizeEventCount()<=1);
+}
+
+
+void DialogBaseTest::testNoChange()
+{
+    TestDialog dlg;
+    dlg.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&dlg));
+    const int passes = dlg.layoutPassCount();
+
+    // Activating the layout or resuming updates when nothing
+    // has changed is not a layout pass
+    dlg.layout()->activate();
+    dlg.beginUpdate();
+    dlg.endUpdate();
+    QCOMPARE(dlg.layoutPassCount(), passes);
+
+    // Neither is a resize, which only moves the existing layout
+    dlg.resize(dlg.size()+QSize(20, 20));
+    QTest::qWait(50);
+    QCOMPARE(dlg.layoutPassCount(), passes);
+}
+
+
+void DialogBaseTest::testChange()
+{
+    TestDialog dlg;
+    dlg.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&dlg));
+
+    // Each change to the contents needs a new layout pass.  The layout
+    // is activated after each change, as would happen if the change
+    // needed its new size immediately.
+    int passes = dlg.layoutPassCount();
+    dlg.label()->setText("A much longer text for the label of the test dialog");
+    dlg.layout()->activate();
+    dlg.label()->setText("An even longer text for the label of the test dialog, which needs a wider dialog");
+    dlg.layout()->activate();
+    QTest::qWait(50);
+    QCOMPARE(dlg.layoutPassCount(), passes+2);
+
+    // The same changes made while updates are suspended need only one.
+    passes = dlg.layoutPassCount();
+    dlg.beginUpdate();
+    dlg.label()->setText("A different text for the label of the test dialog");
+    dlg.layout()->activate();
+    dlg.label()->setText("Yet another, even longer, text for the label of the test dialog, which needs a wider dialog");
+    dlg.layout()->activate();
+    dlg.endUpdate();
+    QTest::qWait(50);
+    QCOMPARE(dlg.layoutPassCount(), passes+1);
+}
+
+
+void DialogBaseTest::testButtonItems()
+{
+    TestDialog dlg;
+    QPushButton *ok = dlg.buttonBox()->button(QDialogButtonBox::Ok);
+    QPushButton *cancel = dlg.buttonBox()->button(QDialogButtonBox::Cancel);
+    const QString cancelText = cancel->text();
+
+    // An item with only an icon and a tool tip is used, but
+    // a null item keeps the button's standard text.
+    QPixmap pix(16, 16);
+    pix.fill(Qt::red);
+    dlg.setButtons({ { QDialogButtonBox::Ok, KGuiItem(QString(), QIcon(pix), "Icon only") },
+                     { QDialogButtonBox::Cancel } });
+    QCOMPARE(dlg.buttonBox()->button(QDialogButtonBox::Ok), ok);
+    QVERIFY(ok->text().isEmpty());
+    QVERIFY(!ok->icon().isNull());
+    QCOMPARE(ok->toolTip(), QString("Icon only"));
+    QCOMPARE(cancel->text(), cancelText);
+    QVERIFY(!cancelText.isEmpty());
+}
+
+
+QTEST_MAIN(DialogBaseTest)
+
+#include "dialogbasetest.moc"
@@ -0,0 +1,165 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include <qtest.h>
+#include <qdialog.h>
+#include <qlayout.h>
+#include <qlabel.h>
+#include <qlineedit.h>
+#include <qcombobox.h>
+#include <qgroupbox.h>
+#include <qstandardpaths.h>
+#include <qtemporarydir.h>
+#include <qwindow.h>
+#include <qscreen.h>
+
+#include <kconfig.h>
+#include <kconfiggroup.h>
+
+#include "dialogstatesaver.h"
+
+
+// Benchmark for DialogStateSaver::restoreWindowState(), to show that
+// the size hint is not calculated when there is a saved size, either
+// in the geometry index or as old-style width and height entries.
+// The dialog has a deep widget tree, so that calculating its size
+// hint needs a substantial recursive layout calculation.
+
+class DialogStateSaverBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void benchmarkRestore_data();
+    void benchmarkRestore();
+
+private:
+    QTemporaryDir *mTempDir;
+    KConfig *mConfig;
+    QDialog *mDialog;
+};
+
+
+static void addLevel(QBoxLayout *lay, int depth)
+{
+    for (int i = 0; i<4; ++i)
+    {
+        lay->addWidget(new QLabel(QString("Label %1/%2").arg(depth).arg(i)));
+        lay->addWidget(new QLineEdit(QString("Text %1/%2").arg(depth).arg(i)));
+
+        QComboBox *combo = new QComboBox;
+        for (int j = 0; j<20; ++j) combo->addItem(QString("Item %1").arg(j));
+        lay->addWidget(combo);
+    }
+
+    if (depth==0) return;
+
+    QGroupBox *box = new QGroupBox(QString("Group %1").arg(depth));
+    QBoxLayout *inner = (depth%2)==0 ? static_cast<QBoxLayout *>(new QVBoxLayout(box))
+                                     : static_cast<QBoxLayout *>(new QHBoxLayout(box));
+    addLevel(inner, depth-1);
+    lay->addWidget(box);
+}
+
+
+// Make the next size hint calculation start from scratch,
+// as it would for a dialog being shown for the first time.
+static void invalidateLayouts(QWidget *widget)
+{
+    const QList<QLayout *> layouts = widget->findChildren<QLayout *>();
+    for (QLayout *lay : layouts) lay->invalidate();
+}
+
+
+void DialogStateSaverBenchmark::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+
+    mTempDir = new QTemporaryDir;
+    QVERIFY(mTempDir->isValid());
+    mConfig = new KConfig(mTempDir->filePath("benchmarkrc"), KConfig::SimpleConfig);
+
+    mDialog = new QDialog;
+    mDialog->setObjectName("DeepDialog");
+    QVBoxLayout *lay = new QVBoxLayout(mDialog);
+    addLevel(lay, 8);
+
+    // Save a size which is different from the size hint
+    const QSize savedSize = mDialog->sizeHint()+QSize(123, 45);
+    mDialog->resize(savedSize);
+    KConfigGroup grp = mConfig->group("Saved");
+    DialogStateSaver::saveWindowState(mDialog, grp);
+
+    mDialog->resize(100, 100);
+    DialogStateSaver::restoreWindowState(mDialog, grp);
+    QCOMPARE(mDialog->size(), savedSize);
+
+    // The same size saved in the old style, by the screen width and
+    // height only, as by previous versions of the library.
+    const QRect screenRect = mDialog->windowHandle()->screen()->geometry();
+    KConfigGroup legacyGrp = mConfig->group("Legacy");
+    legacyGrp.writeEntry(QString("Width %1").arg(screenRect.width()), savedSize.width());
+    legacyGrp.writeEntry(QString("Height %1").arg(screenRect.height()), savedSize.height());
+
+    mDialog->resize(100, 100);
+    DialogStateSaver::restoreWindowState(mDialog, legacyGrp);
+    QCOMPARE(mDialog->size(), savedSize);
+}
+
+
+void DialogStateSaverBenchmark::cleanupTestCase()
+{
+    delete mDialog;
+    delete mConfig;
+    delete mTempDir;
+}
+
+
+void DialogStateSaverBenchmark::benchmarkRestore_data()
+{
+    QTest::addColumn<QString>("group");
+    QTest::newRow("saved size") << "Saved";
+    QTest::newRow("old-style saved size") << "Legacy";
+    QTest::newRow("no saved size") << "Empty";
+}
+
+
+void DialogStateSaverBenchmark::benchmarkRestore()
+{
+    QFETCH(QString, group);
+    const KConfigGroup grp = mConfig->group(group);
+
+    // Both cases invalidate the layouts in the same way, so the
+    // difference between them is the cost of the size hint.
+    QBENCHMARK
+    {
+        invalidateLayouts(mDialog);
+        DialogStateSaver::restoreWindowState(mDialog, grp);
+    }
+}
+
+
+QTEST_MAIN(DialogStateSaverBenchmark)
+
+#include "dialogstatesaverbenchmark.moc"
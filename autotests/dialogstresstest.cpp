@@ -0,0 +1,333 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include <functional>
+#include <unistd.h>
+
+#include <qtest.h>
+#include <qapplication.h>
+#include <qlabel.h>
+#include <qlineedit.h>
+#include <qlayout.h>
+#include <qgroupbox.h>
+#include <qpushbutton.h>
+#include <qdialogbuttonbox.h>
+#include <qfile.h>
+#include <qstandardpaths.h>
+
+#include <kconfiggroup.h>
+
+#include "dialogbase.h"
+#include "dialogmanager.h"
+#include "dialogstatesaver.h"
+#include "dialogstatewatcher.h"
+
+
+// Stress test which opens and closes each of the registered dialogues
+// many times, in the same way as an application would, and checks that
+// nothing is left behind.  The numbers of dialogues, state savers,
+// widgets and objects must return to what they were before, and the
+// resident memory must not keep growing once everything that is
+// cached (fonts, icons, config files) has been loaded.
+
+static const int sIterations = 200;			// open and close this many times
+static const int sWarmup = 20;				// before measuring memory
+static const long sMaxGrowthKb = 1024;			// allowed memory growth
+
+
+class SimpleDialog : public DialogBase
+{
+    Q_OBJECT
+
+public:
+    explicit SimpleDialog(QWidget *pnt = nullptr)
+        : DialogBase(pnt)
+    {
+        setObjectName("StressSimpleDialog");
+        setMainWidget(new QLabel("A simple dialog", this));
+        setButtons(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
+        setButtonIcon(QDialogButtonBox::Ok, "dialog-ok");
+    }
+};
+
+
+class DeepDialog : public DialogBase
+{
+    Q_OBJECT
+
+public:
+    explicit DeepDialog(QWidget *pnt = nullptr)
+        : DialogBase(pnt)
+    {
+        setObjectName("StressDeepDialog");
+        QWidget *w = new QWidget(this);
+        QVBoxLayout *lay = new QVBoxLayout(w);
+        for (int i = 0; i<4; ++i)
+        {
+            QGroupBox *box = new QGroupBox(QString("Group %1").arg(i), w);
+            QHBoxLayout *boxLay = new QHBoxLayout(box);
+            for (int j = 0; j<6; ++j) boxLay->addWidget(new QLineEdit(QString("Text %1/%2").arg(i).arg(j), box));
+            lay->addWidget(box);
+        }
+        setMainWidget(w);
+        setButtons(QDialogButtonBox::Ok|QDialogButtonBox::Cancel|QDialogButtonBox::Apply);
+    }
+};
+
+
+class TextStateSaver : public DialogStateSaver
+{
+public:
+    TextStateSaver(QDialog *pnt, QLineEdit *edit)
+        : DialogStateSaver(pnt),
+          mEdit(edit)						{}
+
+protected:
+    void saveConfig(QDialog *dialog, KConfigGroup &grp) const override
+    {
+        grp.writeEntry("Text", mEdit->text());
+        DialogStateSaver::saveConfig(dialog, grp);
+    }
+
+    void restoreConfig(QDialog *dialog, const KConfigGroup &grp) override
+    {
+        mEdit->setText(grp.readEntry("Text", QString()));
+        DialogStateSaver::restoreConfig(dialog, grp);
+    }
+
+private:
+    QLineEdit *mEdit;
+};
+
+
+class SaverDialog : public DialogBase
+{
+    Q_OBJECT
+
+public:
+    explicit SaverDialog(QWidget *pnt = nullptr)
+        : DialogBase(pnt)
+    {
+        setObjectName("StressSaverDialog");
+        QLineEdit *edit = new QLineEdit("Saved text", this);
+        setMainWidget(edit);
+        setButtons(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
+        mSaver = new TextStateSaver(this, edit);
+        setStateSaver(mSaver);
+    }
+
+    ~SaverDialog() override
+    {
+        delete mSaver;					// not owned by the watcher
+    }
+
+private:
+    TextStateSaver *mSaver;
+};
+
+
+// A plain QDialog, as for example a KPageDialog, with a state watcher
+static QDialog *createWatchedDialog()
+{
+    QDialog *dlg = new QDialog;
+    dlg->setObjectName("StressWatchedDialog");
+    QVBoxLayout *lay = new QVBoxLayout(dlg);
+    lay->addWidget(new QLabel("A watched dialog", dlg));
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel, dlg);
+    QObject::connect(buttons, &QDialogButtonBox::accepted, dlg, &QDialog::accept);
+    QObject::connect(buttons, &QDialogButtonBox::rejected, dlg, &QDialog::reject);
+    lay->addWidget(buttons);
+
+    DialogStateWatcher *watcher = new DialogStateWatcher(dlg);
+    watcher->setSaveOnButton(buttons->button(QDialogButtonBox::Ok));
+    return (dlg);
+}
+
+
+class DialogStressTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testOpenClose_data();
+    void testOpenClose();
+    void testManager_data();
+    void testManager();
+
+private:
+    void addDialogs();
+};
+
+
+static long residentKb()
+{
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) return (-1);	// not Linux
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.count()<2) return (-1);
+    return (fields.at(1).toLong()*(sysconf(_SC_PAGESIZE)/1024));
+}
+
+
+// Let any deferred deletes and other posted events be done
+static void settle()
+{
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    QCoreApplication::processEvents();
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+}
+
+
+// The application's objects, which are all descendants of the application
+// object or are widgets.  The dialogues are top level widgets without a
+// parent object, so they are included in the widget count.
+static int objectCount()
+{
+    return (qApp->findChildren<QObject *>().count()+QApplication::allWidgets().count());
+}
+
+
+typedef std::function<QDialog *()> DialogFactory;
+Q_DECLARE_METATYPE(DialogFactory)
+
+
+void DialogStressTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+
+// The registered dialogues
+void DialogStressTest::addDialogs()
+{
+    QTest::addColumn<DialogFactory>("factory");
+    QTest::newRow("simple") << DialogFactory([]() -> QDialog * { return (new SimpleDialog); });
+    QTest::newRow("deep") << DialogFactory([]() -> QDialog * { return (new DeepDialog); });
+    QTest::newRow("custom saver") << DialogFactory([]() -> QDialog * { return (new SaverDialog); });
+    QTest::newRow("watched QDialog") << DialogFactory(&createWatchedDialog);
+}
+
+
+void DialogStressTest::testOpenClose_data()
+{
+    addDialogs();
+}
+
+
+void DialogStressTest::testOpenClose()
+{
+    QFETCH(DialogFactory, factory);
+
+    const int dialogs = DialogBase::instanceCount();
+    const int savers = DialogStateSaver::instanceCount();
+    int objects = -1;
+    long rss = -1;
+
+    for (int i = 0; i<sIterations; ++i)
+    {
+        if (i==sWarmup)					// everything now loaded
+        {
+            objects = objectCount();
+            rss = residentKb();
+        }
+
+        QDialog *dlg = factory();
+        dlg->show();
+        QVERIFY(QTest::qWaitForWindowExposed(dlg));
+
+        // Alternately accept with the OK button, which saves the
+        // state, and reject, which does not.
+        QDialogButtonBox *buttons = dlg->findChild<QDialogButtonBox *>();
+        QVERIFY(buttons!=nullptr);
+        if ((i%2)==0) buttons->button(QDialogButtonBox::Ok)->click();
+        else dlg->reject();
+        QVERIFY(!dlg->isVisible());
+
+        delete dlg;
+        settle();
+
+        QCOMPARE(DialogBase::instanceCount(), dialogs);
+        QCOMPARE(DialogStateSaver::instanceCount(), savers);
+    }
+
+    const int objectsAfter = objectCount();
+    const long rssAfter = residentKb();
+    qDebug() << "objects" << objects << "->" << objectsAfter << "resident" << rss << "->" << rssAfter << "Kb";
+
+    QCOMPARE(objectsAfter, objects);
+    if (rss>=0) QVERIFY2((rssAfter-rss)<sMaxGrowthKb, "resident memory is growing");
+}
+
+
+void DialogStressTest::testManager_data()
+{
+    addDialogs();
+}
+
+
+void DialogStressTest::testManager()
+{
+    QFETCH(DialogFactory, factory);
+
+    const int dialogs = DialogBase::instanceCount();
+    const int savers = DialogStateSaver::instanceCount();
+    int objects = -1;
+    long rss = -1;
+
+    // The dialogue is reused until the hidden dialogues are released,
+    // which is done at intervals as an application might.
+    for (int i = 0; i<sIterations; ++i)
+    {
+        if (i==sWarmup)
+        {
+            objects = objectCount();
+            rss = residentKb();
+        }
+
+        QDialog *dlg = DialogManager::self()->showDialog("stress", factory);
+        QVERIFY(QTest::qWaitForWindowExposed(dlg));
+        dlg->reject();
+        settle();
+
+        if ((i%10)==9)
+        {
+            DialogManager::self()->releaseHidden();
+            settle();
+            QVERIFY(DialogManager::self()->dialog("stress")==nullptr);
+            QCOMPARE(DialogBase::instanceCount(), dialogs);
+            QCOMPARE(DialogStateSaver::instanceCount(), savers);
+        }
+    }
+
+    const int objectsAfter = objectCount();
+    const long rssAfter = residentKb();
+    qDebug() << "objects" << objects << "->" << objectsAfter << "resident" << rss << "->" << rssAfter << "Kb";
+
+    QCOMPARE(objectsAfter, objects);
+    if (rss>=0) QVERIFY2((rssAfter-rss)<sMaxGrowthKb, "resident memory is growing");
+}
+
+
+QTEST_MAIN(DialogStressTest)
+
+#include "dialogstresstest.moc"
@@ -0,0 +1,66 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <qimageiohandler.h>
+
+
+// An image format plugin which aborts the process as soon as its
+// library is loaded.  The test which uses it can therefore only pass
+// if the plugin's metadata is read without the plugin being loaded.
+
+struct AbortOnLoad
+{
+    AbortOnLoad()
+    {
+        fprintf(stderr, "The failing image plugin was loaded\n");
+        abort();
+    }
+};
+
+static AbortOnLoad sAbortOnLoad;
+
+
+class FailingImagePlugin : public QImageIOPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID QImageIOHandlerFactoryInterface_iid FILE "failingimageplugin.json")
+
+public:
+    QImageIOPlugin::Capabilities capabilities(QIODevice *device, const QByteArray &format) const override
+    {
+        Q_UNUSED(device);
+        Q_UNUSED(format);
+        return (QImageIOPlugin::Capabilities());
+    }
+
+    QImageIOHandler *create(QIODevice *device, const QByteArray &format) const override
+    {
+        Q_UNUSED(device);
+        Q_UNUSED(format);
+        return (nullptr);
+    }
+};
+
+#include "failingimageplugin.moc"
@@ -0,0 +1,290 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include <qtest.h>
+#include <qguiapplication.h>
+#include <qscreen.h>
+#include <qtemporarydir.h>
+#include <qdatetime.h>
+
+#include <kconfig.h>
+#include <kconfiggroup.h>
+
+#include "geometryindex.h"
+
+
+// Tests for the lookup and storing of saved sizes in the GeometryIndex.
+// The saved entries are written directly, for screen configurations
+// relative to the current (offscreen) screen, and then the result of
+// lookup() is compared with what it should be.
+
+class GeometryIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void cleanupTestCase();
+    void testExact();
+    void testNearest();
+    void testDpiWeighting();
+    void testScaledToScreen();
+    void testMaxScreens();
+    void testLegacy();
+    void testInvalid();
+    void testCompact();
+    void testCompactOther();
+
+private:
+    QString keyFor(int width, int height, int dpi) const;
+    QSize scaledFrom(const QSize &saved, int width, int height) const;
+
+private:
+    QTemporaryDir *mTempDir;
+    KConfig *mConfig;
+    KConfigGroup mGroup;
+    QScreen *mScreen;
+    int mWidth;
+    int mHeight;
+    int mDpi;
+};
+
+
+void GeometryIndexTest::initTestCase()
+{
+    mTempDir = new QTemporaryDir;
+    QVERIFY(mTempDir->isValid());
+    mConfig = new KConfig(mTempDir->filePath("geometryrc"), KConfig::SimpleConfig);
+
+    mScreen = QGuiApplication::primaryScreen();
+    QVERIFY(mScreen!=nullptr);
+    mWidth = mScreen->geometry().width();
+    mHeight = mScreen->geometry().height();
+    mDpi = qRound(mScreen->logicalDotsPerInch());
+}
+
+
+void GeometryIndexTest::init()
+{
+    mGroup = mConfig->group("Dialog");
+}
+
+
+void GeometryIndexTest::cleanup()
+{
+    mGroup.deleteGroup();
+    GeometryIndex::setMaxScreens(4);
+}
+
+
+void GeometryIndexTest::cleanupTestCase()
+{
+    delete mConfig;
+    delete mTempDir;
+}
+
+
+QString GeometryIndexTest::keyFor(int width, int height, int dpi) const
+{
+    return (QString("%1x%2@%3").arg(width).arg(height).arg(dpi));
+}
+
+
+// The same scaling as GeometryIndex::lookup(), from a saved screen
+// configuration to the current one.
+QSize GeometryIndexTest::scaledFrom(const QSize &saved, int width, int height) const
+{
+    const QSize scaled(qRound(double(saved.width())*mWidth/width),
+                       qRound(double(saved.height())*mHeight/height));
+    return (scaled.boundedTo(mScreen->availableGeometry().size()));
+}
+
+
+void GeometryIndexTest::testExact()
+{
+    const GeometryIndex::Keys keys = GeometryIndex::keysFor(mScreen);
+    QCOMPARE(keys.screen, keyFor(mWidth, mHeight, mDpi));
+    QCOMPARE(keys.size, "Size "+keys.screen);
+    QCOMPARE(keys.used, "Used "+keys.screen);
+
+    GeometryIndex::store(mGroup, mScreen, QSize(400, 300));
+    QCOMPARE(mGroup.readEntry("Screens", QStringList()), QStringList(keys.screen));
+
+    QSize size;
+    QVERIFY(GeometryIndex::lookup(mGroup, mScreen, &size));
+    QCOMPARE(size, QSize(400, 300));
+}
+
+
+void GeometryIndexTest::testNearest()
+{
+    // A much larger screen, and one only a little wider
+    const QString farKey = keyFor(mWidth*2, mHeight*2, mDpi);
+    const QString nearKey = keyFor(mWidth+40, mHeight, mDpi);
+    mGroup.writeEntry("Screens", QStringList() << farKey << nearKey);
+    mGroup.writeEntry("Size "+farKey, QSize(500, 400));
+    mGroup.writeEntry("Size "+nearKey, QSize(300, 200));
+
+    QSize size;
+    QVERIFY(GeometryIndex::lookup(mGroup, mScreen, &size));
+    QCOMPARE(size, scaledFrom(QSize(300, 200), mWidth+40, mHeight));
+}
+
+
+void GeometryIndexTest::testDpiWeighting()
+{
+    // The same resolution at a different DPI is further away
+    // than a different resolution at the same DPI.
+    const QString dpiKey = keyFor(mWidth, mHeight, mDpi+50);
+    const QString resKey = keyFor(mWidth+300, mHeight, mDpi);
+    mGroup.writeEntry("Screens", QStringList() << dpiKey << resKey);
+    mGroup.writeEntry("Size "+dpiKey, QSize(500, 400));
+    mGroup.writeEntry("Size "+resKey, QSize(300, 200));
+
+    QSize size;
+    QVERIFY(GeometryIndex::lookup(mGroup, mScreen, &size));
+    QCOMPARE(size, scaledFrom(QSize(300, 200), mWidth+300, mHeight));
+}
+
+
+void GeometryIndexTest::testScaledToScreen()
+{
+    // A window filling a screen half the size is scaled to fill this
+    // one, but limited to the available area.
+    const QString halfKey = keyFor(mWidth/2, mHeight/2, mDpi);
+    mGroup.writeEntry("Screens", QStringList(halfKey));
+    mGroup.writeEntry("Size "+halfKey, QSize(mWidth/2, mHeight/2));
+
+    QSize size;
+    QVERIFY(GeometryIndex::lookup(mGroup, mScreen, &size));
+    QCOMPARE(size, scaledFrom(QSize(mWidth/2, mHeight/2), mWidth/2, mHeight/2));
+    QVERIFY(size.width()<=mScreen->availableGeometry().width());
+    QVERIFY(size.height()<=mScreen->availableGeometry().height());
+}
+
+
+void GeometryIndexTest::testMaxScreens()
+{
+    GeometryIndex::setMaxScreens(2);
+
+    const QString key1 = keyFor(mWidth+1000, mHeight+1000, mDpi);
+    const QString key2 = keyFor(mWidth+2000, mHeight+2000, mDpi);
+    mGroup.writeEntry("Screens", QStringList() << key1 << key2);
+    mGroup.writeEntry("Size "+key1, QSize(500, 400));
+    mGroup.writeEntry("Size "+key2, QSize(600, 500));
+    mGroup.writeEntry("Used "+key2, 1000);
+
+    // The current screen becomes the most recently used, and the
+    // least recently used is forgotten along with its entries.
+    const QString curKey = GeometryIndex::keysFor(mScreen).screen;
+    GeometryIndex::store(mGroup, mScreen, QSize(400, 300));
+    QCOMPARE(mGroup.readEntry("Screens", QStringList()), QStringList() << curKey << key1);
+    QVERIFY(mGroup.hasKey("Size "+key1));
+    QVERIFY(!mGroup.hasKey("Size "+key2));
+    QVERIFY(!mGroup.hasKey("Used "+key2));
+
+    // Saving again does not duplicate it
+    GeometryIndex::store(mGroup, mScreen, QSize(410, 310));
+    QCOMPARE(mGroup.readEntry("Screens", QStringList()), QStringList() << curKey << key1);
+}
+
+
+void GeometryIndexTest::testLegacy()
+{
+    // Old-style entries are not in the index, so the caller
+    // must fall back to reading them with the legacy keys.
+    const GeometryIndex::Keys keys = GeometryIndex::keysFor(mScreen);
+    QCOMPARE(keys.width, QString("Width %1").arg(mWidth));
+    QCOMPARE(keys.height, QString("Height %1").arg(mHeight));
+    mGroup.writeEntry(keys.width, 450);
+    mGroup.writeEntry(keys.height, 350);
+
+    QSize size;
+    QVERIFY(!GeometryIndex::lookup(mGroup, mScreen, &size));
+
+    // Once saved in the index, they are superseded and removed
+    GeometryIndex::store(mGroup, mScreen, QSize(400, 300));
+    QVERIFY(!mGroup.hasKey(keys.width));
+    QVERIFY(!mGroup.hasKey(keys.height));
+    QVERIFY(GeometryIndex::lookup(mGroup, mScreen, &size));
+    QCOMPARE(size, QSize(400, 300));
+}
+
+
+void GeometryIndexTest::testInvalid()
+{
+    QSize size;
+    QVERIFY(!GeometryIndex::lookup(mGroup, mScreen, &size));
+
+    // Screen keys which cannot be parsed, or have no saved size
+    mGroup.writeEntry("Screens", QStringList() << "garbage" << "x@" << keyFor(mWidth+1000, mHeight, mDpi));
+    QVERIFY(!GeometryIndex::lookup(mGroup, mScreen, &size));
+}
+
+
+void GeometryIndexTest::testCompact()
+{
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    const QString curKey = GeometryIndex::keysFor(mScreen).screen;
+    const QString oldKey = keyFor(mWidth+1000, mHeight+1000, mDpi);
+    mGroup.writeEntry("Screens", QStringList(oldKey));
+    mGroup.writeEntry("Size "+oldKey, QSize(500, 400));
+    mGroup.writeEntry("Used "+oldKey, now-1000);
+    mGroup.writeEntry("Width 1234", 450);
+    GeometryIndex::store(mGroup, mScreen, QSize(400, 300));
+
+    // The screen configuration not used since the cutoff is expired,
+    // and the old-style entries are removed.
+    qint64 lastUsed = 0;
+    QVERIFY(GeometryIndex::compact(mGroup, now-100, &lastUsed));
+    QVERIFY(lastUsed>=now);
+    QCOMPARE(mGroup.readEntry("Screens", QStringList()), QStringList(curKey));
+    QVERIFY(!mGroup.hasKey("Size "+oldKey));
+    QVERIFY(!mGroup.hasKey("Used "+oldKey));
+    QVERIFY(!mGroup.hasKey("Width 1234"));
+    QVERIFY(mGroup.hasKey("Size "+curKey));
+}
+
+
+void GeometryIndexTest::testCompactOther()
+{
+    // A group not saved by the index is not recognised and left
+    // unchanged, even if it has entries with the same keys.
+    const QString oldKey = keyFor(mWidth+1000, mHeight+1000, mDpi);
+    mGroup.writeEntry("Screens", QStringList() << "first" << oldKey);
+    mGroup.writeEntry("Used "+oldKey, 1000);
+    mGroup.writeEntry("Last Used", 1000);
+    mGroup.writeEntry("Width 1234", 450);
+    const QStringList keys = mGroup.keyList();
+
+    qint64 lastUsed = 0;
+    QVERIFY(!GeometryIndex::compact(mGroup, QDateTime::currentSecsSinceEpoch(), &lastUsed));
+    QCOMPARE(mGroup.keyList(), keys);
+    QCOMPARE(mGroup.readEntry("Screens", QStringList()), QStringList() << "first" << oldKey);
+}
+
+
+QTEST_MAIN(GeometryIndexTest)
+
+#include "geometryindextest.moc"
@@ -0,0 +1,153 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include <qtest.h>
+#include <qcoreapplication.h>
+#include <qimagewriter.h>
+
+#include "imageformattable.h"
+
+
+// Tests for the ImageFormatTable.  The only image plugin available is
+// one which aborts the process if it is ever loaded, so the table built
+// from the plugin metadata must not load any plugins at all.  No test
+// may build the table by loading the plugins, except for the last one
+// which first removes the plugin from the library path.  The plugin's
+// metadata lists formats with multiple-dot suffixes, so that matching
+// file names can be tested against a known set of formats.
+
+class ImageFormatTableTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testNoPluginLoad();
+    void testFileName_data();
+    void testFileName();
+    void testBuiltinWriteOptions();
+};
+
+
+void ImageFormatTableTest::initTestCase()
+{
+    QCoreApplication::setLibraryPaths(QStringList(TEST_PLUGIN_DIR));
+}
+
+
+void ImageFormatTableTest::testNoPluginLoad()
+{
+    const ImageFormatTable *table = ImageFormatTable::instance(ImageFormatTable::PluginMetadata);
+    QVERIFY(table!=nullptr);
+
+    // The formats from the plugin metadata are only for reading
+    const ImageFormatTable::Format *fmt = table->formatForMimeName("image/x-xcf");
+    QVERIFY(fmt!=nullptr);
+    QCOMPARE(fmt->capabilities, ImageFormatTable::Capabilities(ImageFormatTable::CanRead));
+
+    // The built in formats have their write options
+    fmt = table->formatForMimeName("image/png");
+    QVERIFY(fmt!=nullptr);
+    QCOMPARE(fmt->capabilities, ImageFormatTable::CanRead|ImageFormatTable::CanWrite);
+    QVERIFY(fmt->writeOptions & ImageFormatTable::SupportsQuality);
+    QVERIFY(fmt->writeOptions & ImageFormatTable::Lossless);
+}
+
+
+void ImageFormatTableTest::testFileName_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<bool>("forWrite");
+    QTest::addColumn<QString>("mimeName");		// null if no match
+
+    QTest::newRow("simple") << "picture.png" << true << "image/png";
+    QTest::newRow("upper case") << "PICTURE.PNG" << true << "image/png";
+    QTest::newRow("mixed case") << "Picture.Png" << false << "image/png";
+    QTest::newRow("path") << "/some.dir/picture.png" << true << "image/png";
+    QTest::newRow("single dot") << "image.xcf" << false << "image/x-xcf";
+    QTest::newRow("multiple dot") << "image.xcf.gz" << false << "image/x-compressed-xcf";
+    QTest::newRow("multiple dot upper case") << "IMAGE.XCF.BZ2" << false << "image/x-compressed-xcf";
+    QTest::newRow("last part only") << "archive.gz" << false << "application/gzip";
+    QTest::newRow("unknown first part") << "archive.tar.gz" << false << "application/gzip";
+    QTest::newRow("extra dots") << "my.image.xcf.gz" << false << "image/x-compressed-xcf";
+    QTest::newRow("no suffix") << "picture" << false << QString();
+    QTest::newRow("dot in directory") << "/some.png/picture" << false << QString();
+    QTest::newRow("trailing dot") << "picture." << false << QString();
+    QTest::newRow("unknown suffix") << "picture.unknown" << false << QString();
+    QTest::newRow("not writable") << "image.xcf" << true << QString();
+}
+
+
+void ImageFormatTableTest::testFileName()
+{
+    QFETCH(QString, fileName);
+    QFETCH(bool, forWrite);
+    QFETCH(QString, mimeName);
+
+    const ImageFormatTable *table = ImageFormatTable::instance(ImageFormatTable::PluginMetadata);
+    const ImageFormatTable::Format *fmt = table->formatForFileName(fileName, (forWrite ? ImageFormatTable::CanWrite : ImageFormatTable::CanRead));
+    if (mimeName.isEmpty()) QVERIFY(fmt==nullptr);
+    else
+    {
+        // Compared by looking up the MIME name, which may be an alias
+        QVERIFY(fmt!=nullptr);
+        QCOMPARE(fmt, table->formatForMimeName(mimeName));
+    }
+}
+
+
+// The write options recorded for the built in formats must be
+// the same as the formats' handlers report.
+void ImageFormatTableTest::testBuiltinWriteOptions()
+{
+    QCoreApplication::setLibraryPaths(QStringList());
+
+    const ImageFormatTable::WriteOptions queried = ImageFormatTable::SupportsQuality|
+                                                   ImageFormatTable::SupportsCompression|
+                                                   ImageFormatTable::SupportsDescription|
+                                                   ImageFormatTable::SupportsAnimation;
+
+    const ImageFormatTable *table = ImageFormatTable::instance(ImageFormatTable::PluginMetadata);
+    const QVector<const ImageFormatTable::Format *> formats = table->formatsFor(ImageFormatTable::CanWrite);
+    QVERIFY(!formats.isEmpty());
+    for (const ImageFormatTable::Format *fmt : formats)
+    {
+        const QList<QByteArray> names = QImageWriter::imageFormatsForMimeType(fmt->mimeName.toLatin1());
+        QVERIFY2(!names.isEmpty(), qPrintable(fmt->mimeName));
+
+        QImageWriter writer;
+        writer.setFormat(names.first());
+        ImageFormatTable::WriteOptions expected;
+        if (writer.supportsOption(QImageIOHandler::Quality)) expected |= ImageFormatTable::SupportsQuality;
+        if (writer.supportsOption(QImageIOHandler::CompressionRatio)) expected |= ImageFormatTable::SupportsCompression;
+        if (writer.supportsOption(QImageIOHandler::Description)) expected |= ImageFormatTable::SupportsDescription;
+        if (writer.supportsOption(QImageIOHandler::Animation)) expected |= ImageFormatTable::SupportsAnimation;
+
+        qDebug() << fmt->mimeName << "expected" << expected;
+        QCOMPARE(fmt->writeOptions & queried, expected);
+    }
+}
+
+
+QTEST_GUILESS_MAIN(ImageFormatTableTest)
+
+#include "imageformattabletest.moc"
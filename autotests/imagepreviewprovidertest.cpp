@@ -0,0 +1,246 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include <qtest.h>
+#include <qsignalspy.h>
+#include <qthreadpool.h>
+#include <qsemaphore.h>
+#include <qtemporarydir.h>
+#include <qimage.h>
+
+#include "imagepreviewprovider.h"
+
+
+// Tests for the ImagePreviewProvider.  The provider uses its own thread
+// pool with a single thread, which can be kept busy by a blocking job so
+// that preview jobs stay in the queue while they are cancelled or
+// invalidated.
+
+class BlockingJob : public QRunnable
+{
+public:
+    BlockingJob(QSemaphore *started, QSemaphore *release)
+        : mStarted(started),
+          mRelease(release)					{}
+
+    void run() override
+    {
+        mStarted->release();
+        mRelease->acquire();
+    }
+
+private:
+    QSemaphore *mStarted;
+    QSemaphore *mRelease;
+};
+
+
+class ImagePreviewProviderTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void cleanupTestCase();
+    void testPreview();
+    void testCancelQueued();
+    void testVisibleFiles();
+    void testInvalidateQueued();
+    void testInvalidateCached();
+
+private:
+    QString makeImage(const QString &name, const QSize &size) const;
+    void blockPool();
+    void releasePool();
+    QStringList readyFiles(const QSignalSpy &spy) const;
+
+private:
+    QTemporaryDir *mTempDir;
+    QThreadPool *mPool;
+    QSemaphore mStarted;
+    QSemaphore mRelease;
+    ImagePreviewProvider *mProvider;
+};
+
+
+void ImagePreviewProviderTest::initTestCase()
+{
+    mTempDir = new QTemporaryDir;
+    QVERIFY(mTempDir->isValid());
+}
+
+
+void ImagePreviewProviderTest::init()
+{
+    mPool = new QThreadPool;
+    mPool->setMaxThreadCount(1);
+    mProvider = new ImagePreviewProvider;
+    mProvider->setThreadPool(mPool);
+}
+
+
+void ImagePreviewProviderTest::cleanup()
+{
+    delete mProvider;
+    mPool->waitForDone();
+    delete mPool;
+}
+
+
+void ImagePreviewProviderTest::cleanupTestCase()
+{
+    delete mTempDir;
+}
+
+
+QString ImagePreviewProviderTest::makeImage(const QString &name, const QSize &size) const
+{
+    QImage img(size, QImage::Format_RGB32);
+    img.fill(Qt::darkCyan);
+    const QString file = mTempDir->filePath(name);
+    if (!img.save(file, "PNG")) return (QString());
+    return (file);
+}
+
+
+// Occupy the pool's only thread, so that any jobs started are queued
+void ImagePreviewProviderTest::blockPool()
+{
+    mPool->start(new BlockingJob(&mStarted, &mRelease));
+    mStarted.acquire();
+}
+
+
+// Let the queued jobs run, and deliver their results
+void ImagePreviewProviderTest::releasePool()
+{
+    mRelease.release();
+    mPool->waitForDone();
+    QCoreApplication::processEvents();
+}
+
+
+QStringList ImagePreviewProviderTest::readyFiles(const QSignalSpy &spy) const
+{
+    QStringList files;
+    for (const QList<QVariant> &args : spy) files.append(args.at(0).toString());
+    files.sort();
+    return (files);
+}
+
+
+void ImagePreviewProviderTest::testPreview()
+{
+    const QString file = makeImage("large.png", QSize(400, 200));
+    QVERIFY(!file.isEmpty());
+    QSignalSpy spy(mProvider, &ImagePreviewProvider::previewReady);
+
+    QVERIFY(mProvider->preview(file).isNull());		// not available yet
+    QTRY_COMPARE(spy.count(), 1);
+    const QImage image = spy.at(0).at(1).value<QImage>();
+    QCOMPARE(image.size(), QSize(128, 64));
+
+    // Now it is cached
+    QCOMPARE(mProvider->preview(file).size(), QSize(128, 64));
+    QCOMPARE(spy.count(), 1);
+
+    // Not an image file name
+    QVERIFY(mProvider->preview(mTempDir->filePath("file.txt")).isNull());
+}
+
+
+void ImagePreviewProviderTest::testCancelQueued()
+{
+    const QString file1 = makeImage("cancel1.png", QSize(50, 50));
+    const QString file2 = makeImage("cancel2.png", QSize(50, 50));
+    QSignalSpy spy(mProvider, &ImagePreviewProvider::previewReady);
+
+    blockPool();
+    mProvider->preview(file1);
+    mProvider->preview(file2);
+    mProvider->cancel(file1);				// taken from the queue
+    releasePool();
+    QCOMPARE(readyFiles(spy), QStringList(file2));
+
+    // It is no longer pending, so it is started again when wanted
+    QVERIFY(mProvider->preview(file1).isNull());
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(1).at(0).toString(), file1);
+}
+
+
+void ImagePreviewProviderTest::testVisibleFiles()
+{
+    const QString file1 = makeImage("visible1.png", QSize(50, 50));
+    const QString file2 = makeImage("visible2.png", QSize(50, 50));
+    const QString file3 = makeImage("visible3.png", QSize(50, 50));
+    QSignalSpy spy(mProvider, &ImagePreviewProvider::previewReady);
+
+    blockPool();
+    mProvider->preview(file1);
+    mProvider->preview(file2);
+    mProvider->preview(file3);
+    mProvider->setVisibleFiles(QStringList() << file2);
+    releasePool();
+    QCOMPARE(readyFiles(spy), QStringList(file2));
+}
+
+
+void ImagePreviewProviderTest::testInvalidateQueued()
+{
+    const QString file = makeImage("invalidate.png", QSize(50, 50));
+    QSignalSpy spy(mProvider, &ImagePreviewProvider::previewReady);
+
+    blockPool();
+    mProvider->preview(file);
+    mProvider->invalidate(file);			// taken from the queue
+    releasePool();
+    QCOMPARE(spy.count(), 0);
+
+    // The file has changed, and the new preview is of the new file
+    makeImage("invalidate.png", QSize(60, 30));
+    mProvider->preview(file);
+    QTRY_COMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(1).value<QImage>().size(), QSize(60, 30));
+}
+
+
+void ImagePreviewProviderTest::testInvalidateCached()
+{
+    const QString file = makeImage("cached.png", QSize(50, 50));
+    QSignalSpy spy(mProvider, &ImagePreviewProvider::previewReady);
+
+    mProvider->preview(file);
+    QTRY_COMPARE(spy.count(), 1);
+    QVERIFY(!mProvider->preview(file).isNull());
+
+    mProvider->invalidate(file);
+    QVERIFY(mProvider->preview(file).isNull());		// generated again
+    QTRY_COMPARE(spy.count(), 2);
+}
+
+
+QTEST_GUILESS_MAIN(ImagePreviewProviderTest)
+
+#include "imagepreviewprovidertest.moc"
@@ -0,0 +1,131 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include <qtest.h>
+#include <qprocess.h>
+
+
+// Benchmark for the time and memory taken to load the core library,
+// compared with the dialogue library.  The core library is intended
+// for tools which do not need QtWidgets or KIO, so it must not load
+// either of them, and it must be cheaper to load than libkfdialog.
+//
+// Each measurement is done by the helper in a new process, which
+// loads the library with all of its symbols resolved (so that the
+// time includes relocation) and reports the time in microseconds
+// and the increase in resident memory in kilobytes.
+
+class StartupBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void benchmarkLoad_data();
+    void benchmarkLoad();
+    void testCoreDependencies();
+
+private:
+    struct Result
+    {
+        qint64 usec;
+        long rssKb;
+        bool widgets;
+        bool kio;
+    };
+
+    Result measure(const QString &library, int runs = 5);
+};
+
+
+StartupBenchmark::Result StartupBenchmark::measure(const QString &library, int runs)
+{
+    Result best { -1, -1, false, false };
+
+    // The fastest of several runs is the one least disturbed
+    // by anything else happening on the system.
+    for (int i = 0; i<runs; ++i)
+    {
+        QProcess proc;
+        proc.start(STARTUP_HELPER, QStringList() << library);
+        if (!proc.waitForFinished(30*1000) || proc.exitCode()!=0)
+        {
+            qWarning() << "helper failed" << proc.readAllStandardError();
+            return (best);
+        }
+
+        const QList<QByteArray> fields = proc.readAllStandardOutput().simplified().split(' ');
+        if (fields.count()!=4) return (best);
+
+        const qint64 usec = fields.at(0).toLongLong();
+        if (best.usec<0 || usec<best.usec) best.usec = usec;
+        best.rssKb = fields.at(1).toLong();		// should be the same every time
+        best.widgets = (fields.at(2)=="1");
+        best.kio = (fields.at(3)=="1");
+    }
+
+    return (best);
+}
+
+
+void StartupBenchmark::initTestCase()
+{
+    QVERIFY(QFile::exists(STARTUP_HELPER));
+}
+
+
+void StartupBenchmark::benchmarkLoad_data()
+{
+    QTest::addColumn<QString>("library");
+    QTest::newRow("libkfdialogcore") << CORE_LIBRARY;
+    QTest::newRow("libkfdialog") << DIALOG_LIBRARY;
+}
+
+
+void StartupBenchmark::benchmarkLoad()
+{
+    QFETCH(QString, library);
+    const Result res = measure(library);
+    QVERIFY(res.usec>=0);
+
+    qDebug() << "resident memory" << res.rssKb << "Kb";
+    QTest::setBenchmarkResult(res.usec/1000.0, QTest::WalltimeMilliseconds);
+}
+
+
+void StartupBenchmark::testCoreDependencies()
+{
+    const Result core = measure(CORE_LIBRARY, 1);
+    QVERIFY(core.usec>=0);
+    QVERIFY2(!core.widgets, "core library loads QtWidgets");
+    QVERIFY2(!core.kio, "core library loads KIO");
+
+    const Result dialog = measure(DIALOG_LIBRARY, 1);
+    QVERIFY(dialog.usec>=0);
+    QVERIFY(dialog.widgets);
+    QVERIFY(core.rssKb<=dialog.rssKb);
+}
+
+
+QTEST_GUILESS_MAIN(StartupBenchmark)
+
+#include "startupbenchmark.moc"
@@ -0,0 +1,78 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <qlibrary.h>
+#include <qfile.h>
+#include <qelapsedtimer.h>
+
+
+// Helper for the startup benchmark.  It loads the library named on
+// the command line, resolving all of its symbols immediately, and
+// reports on standard output the time taken, the increase in resident
+// memory, and whether QtWidgets or KIO were loaded as dependencies.
+// It must be run as a separate process for each measurement, so that
+// nothing has already been loaded.
+
+static long residentKb()
+{
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) return (0);
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.count()<2) return (0);
+    return (fields.at(1).toLong()*(sysconf(_SC_PAGESIZE)/1024));
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc<2)
+    {
+        fprintf(stderr, "Usage: %s library\n", argv[0]);
+        return (2);
+    }
+
+    QLibrary lib(QFile::decodeName(argv[1]));
+    lib.setLoadHints(QLibrary::ResolveAllSymbolsHint);
+
+    const long before = residentKb();
+    QElapsedTimer timer;
+    timer.start();
+    if (!lib.load())
+    {
+        fprintf(stderr, "%s\n", qPrintable(lib.errorString()));
+        return (1);
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+    const long after = residentKb();
+
+    QFile maps("/proc/self/maps");
+    if (!maps.open(QIODevice::ReadOnly)) return (1);
+    const QByteArray mapped = maps.readAll();
+
+    printf("%lld %ld %d %d\n", elapsed/1000, after-before,
+           mapped.contains("libQt5Widgets") ? 1 : 0,
+           mapped.contains("libKF5KIOCore") ? 1 : 0);
+    return (0);
+}
@@ -29,58 +29,285 @@
 #include <qpushbutton.h>
 #include <qapplication.h>
 #include <QSpacerItem>
+#include <qevent.h>
+#include <qlabel.h>
+#include <qabstractbutton.h>
+#include <qpixmap.h>
+#include <qatomic.h>
+#include <qsharedpointer.h>
 
 #include <kguiitem.h>
 
 #include "dialogstatewatcher.h"
+#include "iconcache.h"
 #include "libkfdialog_logging.h"
 
 
+static QAtomicInt sInstances = 0;
+
+// Typical heap usage of a QObject and a QWidget, including their
+// private data, for the 64-bit platforms.  These are only used as
+// an estimate by DialogBase::memoryUsage().
+static const int sObjectBytes = 200;
+static const int sWidgetBytes = 800;
+
+
+// The top level layout of the dialog, which counts its layout passes.
+// QLayout::activate() does nothing if the layout has not changed since
+// it was last activated, otherwise it invalidates the layout and then
+// sets its geometry.  So only a geometry set after an invalidation
+// is counted; one set just because the dialog has been resized is not.
+class DialogLayout : public QVBoxLayout
+{
+public:
+    explicit DialogLayout(int *passes)
+        : QVBoxLayout(),
+          mPasses(passes),
+          mInvalid(true)					{}
+
+    void invalidate() override
+    {
+        mInvalid = true;
+        QVBoxLayout::invalidate();
+    }
+
+    void setGeometry(const QRect &rect) override
+    {
+        if (mInvalid) ++(*mPasses);			// a real layout pass
+        mInvalid = false;
+        QVBoxLayout::setGeometry(rect);
+    }
+
+private:
+    int *mPasses;
+    bool mInvalid;
+};
+
+
 DialogBase::DialogBase(QWidget *pnt)
     : QDialog(pnt)
 {
     qCDebug(LIBKFDIALOG_LOG);
+    sInstances.ref();
 
     setModal(true);					// convenience, can reset if necessary
 
     mMainWidget = nullptr;					// caller not provided yet
-    mStateWatcher = new DialogStateWatcher(this);	// use our own as default
+    mUpdateDepth = 0;					// updates not suspended
+    mUpdatesWereEnabled = true;
+    mLayoutPasses = 0;
+    mResizeEvents = 0;
+
+    // The button box and state watcher are not created until they are
+    // needed, which is normally when the dialog is first shown.
+    mButtonBox = nullptr;
+    mPendingButtons = QDialogButtonBox::Ok|QDialogButtonBox::Cancel;
+    mStateWatcher = nullptr;
+    mPendingSaver = nullptr;
+    mPendingSaverSet = false;				// use default saver
+}
+
 
-    mButtonBox = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel, this);
+QDialogButtonBox *DialogBase::ensureButtonBox()
+{
+    if (mButtonBox!=nullptr) return (mButtonBox);	// already created
+
+    qCDebug(LIBKFDIALOG_LOG) << "create button box";
+    mButtonBox = new QDialogButtonBox(this);
     connect(mButtonBox, &QDialogButtonBox::accepted, this, &DialogBase::accept);
     connect(mButtonBox, &QDialogButtonBox::rejected, this, &DialogBase::reject);
+    setButtons(mPendingButtons);			// now actually create them
+    return (mButtonBox);
 }
 
 
-void DialogBase::showEvent(QShowEvent *ev)
+DialogStateWatcher *DialogBase::ensureStateWatcher()
 {
-    if (layout()==nullptr)					// layout not yet set up
-    {
-        qCDebug(LIBKFDIALOG_LOG) << "setup layout";
-        QVBoxLayout *mainLayout = new QVBoxLayout;
-        setLayout(mainLayout);
+    if (mStateWatcher!=nullptr) return (mStateWatcher);	// already created
+
+    mStateWatcher = new DialogStateWatcher(this);
+    if (mPendingSaverSet) mStateWatcher->setStateSaver(mPendingSaver);
+    return (mStateWatcher);
+}
+
+
+QDialogButtonBox *DialogBase::buttonBox() const
+{
+    return (const_cast<DialogBase *>(this)->ensureButtonBox());
+}
+
+
+DialogStateWatcher *DialogBase::stateWatcher() const
+{
+    return (const_cast<DialogBase *>(this)->ensureStateWatcher());
+}
 
-        if (mMainWidget==nullptr)
+
+DialogBase::~DialogBase()
+{
+    sInstances.deref();
+}
+
+
+int DialogBase::instanceCount()
+{
+    return (sInstances.load());
+}
+
+
+DialogBase::MemoryUsage DialogBase::memoryUsage() const
+{
+    MemoryUsage usage { 0, 0, 0, 0, 0 };
+
+    const QList<QObject *> objs = findChildren<QObject *>();
+    for (const QObject *obj : objs)
+    {
+        ++usage.objects;
+        if (obj->isWidgetType())
         {
-            qCWarning(LIBKFDIALOG_LOG) << "No main widget set for" << objectName();
-            mMainWidget = new QWidget(this);
+            ++usage.widgets;
+            usage.heapBytes += sWidgetBytes;
+
+            const QLabel *label = qobject_cast<const QLabel *>(obj);
+            if (label!=nullptr)
+            {
+#if QT_VERSION>=QT_VERSION_CHECK(5, 15, 0)
+                const QPixmap pix = label->pixmap(Qt::ReturnByValue);
+#else
+                const QPixmap pix = (label->pixmap()!=nullptr ? *label->pixmap() : QPixmap());
+#endif
+                if (!pix.isNull()) usage.pixmapBytes += qint64(pix.width())*pix.height()*pix.depth()/8;
+            }
+
+            const QAbstractButton *but = qobject_cast<const QAbstractButton *>(obj);
+            if (but!=nullptr && !but->icon().isNull())
+            {
+                const QSize sz = but->icon().actualSize(but->iconSize())*but->devicePixelRatioF();
+                usage.pixmapBytes += qint64(sz.width())*sz.height()*4;
+            }
         }
+        else
+        {
+            if (qobject_cast<const QLayout *>(obj)!=nullptr) ++usage.layouts;
+            usage.heapBytes += sObjectBytes;
+        }
+    }
 
-        mainLayout->addWidget(mMainWidget);
-        mainLayout->setStretchFactor(mMainWidget, 1);
-        mainLayout->addWidget(mButtonBox);
+    usage.heapBytes += sWidgetBytes+usage.pixmapBytes;	// for the dialog itself
+    return (usage);
+}
+
+
+void DialogBase::setupLayout()
+{
+    if (layout()!=nullptr) return;			// layout already set up
+
+    qCDebug(LIBKFDIALOG_LOG) << "setup layout";
+    UpdateScope scope(this);				// lay out once when done
+    QVBoxLayout *mainLayout = new DialogLayout(&mLayoutPasses);
+    setLayout(mainLayout);
+
+    if (mMainWidget==nullptr)
+    {
+        qCWarning(LIBKFDIALOG_LOG) << "No main widget set for" << objectName();
+        mMainWidget = new QWidget(this);
+    }
+
+    mainLayout->addWidget(mMainWidget);
+    mainLayout->setStretchFactor(mMainWidget, 1);
+    mainLayout->addWidget(ensureButtonBox());
+}
+
+
+void DialogBase::setVisible(bool visible)
+{
+    // Set up the layout and restore the saved state before the window
+    // is shown.  Restoring the size here means that QWidget::setVisible()
+    // will not adjust the size itself, so the window is configured and
+    // laid out once at its final size.  This cannot be done at the polish
+    // event, because by then QWidget has already decided whether to adjust
+    // the size.
+    if (visible && !isVisible())
+    {
+        UpdateScope scope(this);			// lay out once when done
+        setupLayout();
+        ensureStateWatcher()->restoreConfig();
     }
 
+    QDialog::setVisible(visible);
+}
+
+
+void DialogBase::showEvent(QShowEvent *ev)
+{
+    setupLayout();					// if not already done
     QDialog::showEvent(ev);				// show the dialogue
 }
 
 
+bool DialogBase::event(QEvent *ev)
+{
+    if (ev->type()==QEvent::Resize && isVisible()) ++mResizeEvents;
+    else if (ev->type()==QEvent::ThemeChange) IconCache::clear();
+    return (QDialog::event(ev));
+}
+
+
+void DialogBase::beginUpdate()
+{
+    if (mUpdateDepth++>0) return;			// already suspended
+
+    mUpdatesWereEnabled = updatesEnabled();
+    setUpdatesEnabled(false);
+    QLayout *lay = layout();
+    if (lay!=nullptr) lay->setEnabled(false);
+}
+
+
+void DialogBase::endUpdate()
+{
+    Q_ASSERT(mUpdateDepth>0);
+    if (--mUpdateDepth>0) return;			// still suspended
+
+    QLayout *lay = layout();				// may have been created since
+    if (lay!=nullptr)
+    {
+        lay->setEnabled(true);
+        lay->activate();				// single layout pass
+    }
+    setUpdatesEnabled(mUpdatesWereEnabled);		// and single repaint
+}
+
+
 void DialogBase::setButtons(QDialogButtonBox::StandardButtons buttons)
 {
     qCDebug(LIBKFDIALOG_LOG) << buttons;
-    mButtonBox->setStandardButtons(buttons);
 
-    if (buttons & QDialogButtonBox::Ok)
+    if (mButtonBox==nullptr)				// button box not created yet,
+    {							// so just remember for then
+        mPendingButtons = buttons;
+        return;
+    }
+
+    // Only add or remove the buttons which have changed, so that
+    // any existing buttons keep their customisations and connections.
+    const QDialogButtonBox::StandardButtons current = mButtonBox->standardButtons();
+    for (int b = QDialogButtonBox::FirstButton; b<=QDialogButtonBox::LastButton; b <<= 1)
+    {
+        const QDialogButtonBox::StandardButton button = static_cast<QDialogButtonBox::StandardButton>(b);
+        const bool want = buttons.testFlag(button);
+        if (want==current.testFlag(button)) continue;	// no change to this button
+
+        if (want) mButtonBox->addButton(button);
+        else
+        {
+            QPushButton *but = mButtonBox->button(button);
+            mButtonBox->removeButton(but);
+            delete but;
+        }
+    }
+
+    if ((buttons & QDialogButtonBox::Ok) && !(current & QDialogButtonBox::Ok))
     {
         qCDebug(LIBKFDIALOG_LOG) << "setup OK button";
         QPushButton *okButton = mButtonBox->button(QDialogButtonBox::Ok);
@@ -93,29 +320,95 @@ void DialogBase::setButtons(QDialogButtonBox::StandardButtons buttons)
 }
 
 
+void DialogBase::setButtons(const QList<DialogBase::ButtonSpec> &specs)
+{
+    // Suspend updates and layout of the button box while all of the
+    // buttons are changed, so that it is only laid out and painted once.
+    ensureButtonBox();
+    const bool updates = mButtonBox->updatesEnabled();
+    mButtonBox->setUpdatesEnabled(false);
+    QLayout *lay = mButtonBox->layout();
+    if (lay!=nullptr) lay->setEnabled(false);
+
+    QDialogButtonBox::StandardButtons buttons;
+    for (const ButtonSpec &spec : specs) buttons |= spec.button;
+    setButtons(buttons);
+
+    for (const ButtonSpec &spec : specs)
+    {
+        QPushButton *but = mButtonBox->button(spec.button);
+        if (but==nullptr) continue;
+
+        // A null item keeps the standard text and icon, but an item
+        // with only an icon or a tool tip is still used.
+        const KGuiItem &item = spec.guiItem;
+        if (!item.text().isEmpty() || item.hasIcon() || !item.toolTip().isEmpty()) assignGuiItem(but, item);
+        but->setEnabled(spec.enabled);
+    }
+
+    if (lay!=nullptr)
+    {
+        lay->setEnabled(true);
+        lay->activate();
+    }
+    mButtonBox->setUpdatesEnabled(updates);
+}
+
+
 void DialogBase::setButtonEnabled(QDialogButtonBox::StandardButton button, bool state)
 {
-    QPushButton *but = mButtonBox->button(button);
+    QPushButton *but = buttonBox()->button(button);
     if (but!=nullptr) but->setEnabled(state);
 }
 
 
 void DialogBase::setButtonText(QDialogButtonBox::StandardButton button, const QString &text)
 {
-    QPushButton *but = mButtonBox->button(button);
+    QPushButton *but = buttonBox()->button(button);
     if (but!=nullptr) but->setText(text);
 }
 
 void DialogBase::setButtonIcon(QDialogButtonBox::StandardButton button, const QIcon &icon)
 {
-    QPushButton *but = mButtonBox->button(button);
+    QPushButton *but = buttonBox()->button(button);
     if (but!=nullptr) but->setIcon(icon);
 }
 
+void DialogBase::setButtonIcon(QDialogButtonBox::StandardButton button, const QString &iconName)
+{
+    QPushButton *but = buttonBox()->button(button);
+    if (but!=nullptr) but->setIcon(IconCache::icon(iconName, but));
+}
+
 void DialogBase::setButtonGuiItem(QDialogButtonBox::StandardButton button, const KGuiItem &guiItem)
 {
-    QPushButton *but = mButtonBox->button(button);
-    if (but!=nullptr) KGuiItem::assign(but, guiItem);
+    QPushButton *but = buttonBox()->button(button);
+    if (but!=nullptr) assignGuiItem(but, guiItem);
+}
+
+
+void DialogBase::assignGuiItem(QPushButton *but, const KGuiItem &guiItem) const
+{
+    // If the item has a theme icon name, then KGuiItem::assign() would
+    // look up the icon again.  Assign the item without it and use the
+    // cached icon instead.
+    const QString iconName = guiItem.iconName();
+    if (iconName.isEmpty())
+    {
+        KGuiItem::assign(but, guiItem);
+        return;
+    }
+
+    KGuiItem item(guiItem);
+    item.setIconName(QString());
+    KGuiItem::assign(but, item);
+    but->setIcon(IconCache::icon(iconName, but));
+}
+
+
+void DialogBase::setIconCacheLimit(int bytes)
+{
+    IconCache::setCacheLimit(bytes);
 }
 
 
@@ -144,13 +437,19 @@ int DialogBase::horizontalSpacing()
 
 void DialogBase::setStateSaver(DialogStateSaver *saver)
 {
-    mStateWatcher->setStateSaver(saver);
+    if (mStateWatcher!=nullptr) mStateWatcher->setStateSaver(saver);
+    else						// watcher not created yet,
+    {							// so just remember for then
+        mPendingSaver = saver;
+        mPendingSaverSet = true;
+    }
 }
 
 
 DialogStateSaver *DialogBase::stateSaver() const
 {
-    return (mStateWatcher->stateSaver());
+    if (mStateWatcher==nullptr && mPendingSaverSet) return (mPendingSaver);
+    return (stateWatcher()->stateSaver());
 }
 
 
@@ -164,3 +463,25 @@ QSpacerItem *DialogBase::horizontalSpacerItem()
 {
     return (new QSpacerItem(horizontalSpacing(), 1, QSizePolicy::Fixed, QSizePolicy::Minimum));
 }
+
+
+void DialogBase::execAsync(const std::function<void(int)> &done)
+{
+    // The connection is made once for each call, and is
+    // disconnected when the dialog has finished.
+    QSharedPointer<QMetaObject::Connection> conn(new QMetaObject::Connection);
+    *conn = connect(this, &QDialog::finished, this, [conn, done](int result)
+    {
+        QObject::disconnect(*conn);
+        // The accepted() signal, and hence the state watcher's save,
+        // may come after finished() depending on the Qt version.  Calling
+        // the function from the event loop ensures that both have been
+        // done, and that it is not called from within QDialog::done().
+        // The application is used as the context because the dialog
+        // may be deleted on close.
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [done, result]() { done(result); },
+                                  Qt::QueuedConnection);
+    });
+
+    open();						// show, but do not block
+}
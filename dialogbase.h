@@ -25,12 +25,18 @@
 
 #include <qdialog.h>
 #include <qdialogbuttonbox.h>
+#include <qlist.h>
+
+#include <functional>
+
+#include <kguiitem.h>
 
 #include "libkfdialog_export.h"
 
 class QShowEvent;
+class QEvent;
 class QSpacerItem;
-class KGuiItem;
+class QPushButton;
 class KConfigGroup;
 class DialogStateWatcher;
 class DialogStateSaver;
@@ -46,6 +52,12 @@ class DialogStateSaver;
  * - Managing the top level layout
  * - Saving and restoring the dialog size
  *
+ * Constructing a dialog is cheap.  The button box and the state watcher
+ * and saver are only created when the dialog is first shown, or when they
+ * are accessed, so a dialog which is constructed but never shown costs
+ * very little.  The buttons and state saver can be set at any time before
+ * then, without the defaults being created and then thrown away.
+ *
  * @author Jonathan Marten
  **/
 
@@ -54,11 +66,142 @@ class LIBKFDIALOG_EXPORT DialogBase : public QDialog
     Q_OBJECT
 
 public:
+    /**
+     * A specification for a button, used by @c setButtons().
+     **/
+    struct ButtonSpec
+    {
+        /**
+         * Constructor.
+         *
+         * @param but The standard button, which also determines its role
+         * @param item The @c KGuiItem for the button.  If this is a null
+         * item (that is, it has no text, icon or tool tip), then the button
+         * has its standard text and icon.
+         * @param en The enable state for the button
+         **/
+        ButtonSpec(QDialogButtonBox::StandardButton but, const KGuiItem &item = KGuiItem(), bool en = true)
+            : button(but), guiItem(item), enabled(en)		{}
+
+        QDialogButtonBox::StandardButton button;	///< The standard button
+        KGuiItem guiItem;				///< Text, icon and tips
+        bool enabled;					///< Enable state
+    };
+
+    /**
+     * Suspends updates and layout of a dialog for as long as it exists.
+     *
+     * This is a convenience for calling @c beginUpdate() and @c endUpdate().
+     * Create one on the stack while making a number of changes to the
+     * dialog, for example restoring the state of its widgets.
+     *
+     * @code
+     * {
+     *     DialogBase::UpdateScope scope(this);
+     *     // change many widget states
+     * }     // single layout and paint here
+     * @endcode
+     **/
+    class UpdateScope
+    {
+    public:
+        explicit UpdateScope(DialogBase *dlg)
+            : mDialog(dlg)					{ mDialog->beginUpdate(); }
+        ~UpdateScope()					{ mDialog->endUpdate(); }
+
+    private:
+        Q_DISABLE_COPY(UpdateScope)
+        DialogBase *mDialog;
+    };
+
+    /**
+     * Approximate memory usage of a dialog, as returned by @c memoryUsage().
+     **/
+    struct MemoryUsage
+    {
+        int objects;					///< Number of child objects
+        int widgets;					///< Number of those that are widgets
+        int layouts;					///< Number of those that are layouts
+        qint64 pixmapBytes;				///< Size of label pixmaps and button icons
+        qint64 heapBytes;				///< Estimated total heap size
+    };
+
     /**
      * Destructor.
      *
      **/
-    virtual ~DialogBase() = default;
+    ~DialogBase() override;
+
+    /**
+     * Suspend updates and layout of the dialog.
+     *
+     * Painting is disabled and the top level layout is not activated
+     * until the matching @c endUpdate() is called, so that making a
+     * number of changes to the dialog does not cause a layout pass
+     * and repaint for each one.  Calls may be nested, in which case
+     * updates are resumed at the outermost @c endUpdate().
+     *
+     * This is done automatically while the dialog layout is being
+     * set up and while its state is being restored.
+     *
+     * @see UpdateScope
+     **/
+    void beginUpdate();
+
+    /**
+     * Resume updates and layout of the dialog.
+     *
+     * If this matches the outermost @c beginUpdate(), then the top level
+     * layout is activated once and the dialog is repainted.
+     **/
+    void endUpdate();
+
+    /**
+     * Get the number of layout passes that the dialog has done.
+     *
+     * This is for instrumentation, in order to check that changes to
+     * the dialog are not causing more layout passes than necessary.
+     *
+     * @return the number of times that the top level layout has been
+     * activated.  An activation which does nothing, because the layout
+     * has not changed since it was last activated, is not counted.
+     **/
+    int layoutPassCount() const				{ return (mLayoutPasses); }
+
+    /**
+     * Get the number of resize events that the dialog has received.
+     *
+     * This is for instrumentation, in the same way as @c layoutPassCount().
+     * Each resize of a window that is shown corresponds to a configure
+     * and expose of the native window.
+     *
+     * @return the number of resize events
+     **/
+    int resizeEventCount() const			{ return (mResizeEvents); }
+
+    /**
+     * Get the approximate memory usage of the dialog.
+     *
+     * This is for instrumentation, in order to find out how much memory
+     * a dialog holds and whether it grows as the dialog is used.  All of
+     * the dialog's descendant objects are counted.  The heap size is only
+     * an estimate, from a typical size for each object and widget plus the
+     * size of the pixmaps shown by labels and the icons shown on buttons.
+     *
+     * @return the memory usage
+     **/
+    MemoryUsage memoryUsage() const;
+
+    /**
+     * Get the number of DialogBase instances which currently exist.
+     *
+     * This is for instrumentation, in order to check that dialogs which
+     * are created and closed repeatedly are actually deleted.
+     *
+     * @return the number of instances
+     * @see DialogStateSaver::instanceCount()
+     **/
+    static int instanceCount();
 
     /**
      * Retrieve the main widget.
@@ -97,11 +240,12 @@ public:
     /**
      * Access the state watcher used by the dialog.
      *
-     * This is created and used internally.
+     * This is created and used internally.  It is created when the dialog
+     * is first shown, or when this is first called.
      *
      * @return the state watcher
      **/
-    DialogStateWatcher *stateWatcher() const		{ return (mStateWatcher); }
+    DialogStateWatcher *stateWatcher() const;
 
     /**
      * Get a spacing hint suitable for use within the dialog layout.
@@ -143,9 +287,12 @@ public:
     /**
      * Access the dialog's button box.
      *
+     * The button box is created when the dialog is first shown, or when
+     * this or any other function that needs the buttons is first called.
+     *
      * @return the button box
      **/
-    QDialogButtonBox *buttonBox() const			{ return (mButtonBox); }
+    QDialogButtonBox *buttonBox() const;
 
     /**
      * Set the standard buttons to be displayed within the button box.
@@ -153,12 +300,36 @@ public:
      * @param buttons The buttons required
      *
      * @note This can be called at any time and the buttons will change
-     * accordingly.  However, the buttons will be regenerated which means
-     * that any special button text or icons, or any signal connections from
-     * them, will be lost.
+     * accordingly.  Only buttons which are added or removed are changed,
+     * so any existing buttons which are still required keep their special
+     * text or icons and any signal connections from them.  If the button
+     * box has not been created yet, then the buttons are just remembered
+     * until it is.  The default is @c Ok and @c Cancel.
      **/
     void setButtons(QDialogButtonBox::StandardButtons buttons);
 
+    /**
+     * Set the buttons to be displayed within the button box, and their
+     * text, icons and enable state.
+     *
+     * All of the buttons are set up in one operation, with the button box
+     * only being laid out and painted once at the end.  This is useful
+     * for a dialogue, such as a wizard, which changes its buttons
+     * depending on the current page.
+     *
+     * @code
+     * setButtons({ { QDialogButtonBox::Ok, KStandardGuiItem::ok(), canFinish },
+     *              { QDialogButtonBox::Cancel } });
+     * @endcode
+     *
+     * @param specs The buttons required
+     *
+     * @note As for the other @c setButtons(), any existing buttons which
+     * are still required are kept.  Buttons which have a null @c KGuiItem
+     * in their specification keep their current text and icon.
+     **/
+    void setButtons(const QList<DialogBase::ButtonSpec> &specs);
+
     /**
      * Set the enable state of a button.
      *
@@ -189,6 +360,23 @@ public:
      **/
     void setButtonIcon(QDialogButtonBox::StandardButton button, const QIcon &icon);
 
+    /**
+     * Set the icon of a button from the icon theme.
+     *
+     * The icon is rendered at the button's icon size and pixel ratio,
+     * and is kept in a cache shared by all dialogs, so that it does not
+     * need to be looked up and rendered again the next time that it is
+     * used.
+     *
+     * @param button The button to set
+     * @param iconName The theme icon name
+     *
+     * @note This can be called at any time, and the button will change
+     * accordingly.
+     * @see setIconCacheLimit()
+     **/
+    void setButtonIcon(QDialogButtonBox::StandardButton button, const QString &iconName);
+
     /**
      * Set up a button from a @c KGuiItem.
      *
@@ -200,6 +388,57 @@ public:
      **/
     void setButtonGuiItem(QDialogButtonBox::StandardButton button, const KGuiItem &guiItem);
 
+    /**
+     * Set the memory budget for the cache of button icons.  This is
+     * an application-wide setting, and the default is 2Mb.
+     *
+     * Theme icons set by @c setButtonIcon(), @c setButtonGuiItem() and
+     * @c setButtons() are cached after they have been rendered, for each
+     * size and device pixel ratio used.  If the icon theme is changed
+     * then the cache is cleared.
+     *
+     * @param bytes The maximum size of the cached icons
+     **/
+    static void setIconCacheLimit(int bytes);
+
+    /**
+     * Show the dialog and call a function when it is finished.
+     *
+     * This is an alternative to @c QDialog::exec() which does not run
+     * a nested event loop.  The dialog is shown using @c QDialog::open(),
+     * so it is window modal, and this function returns immediately.
+     * When the dialog is accepted or rejected, the function is called
+     * with the result code.
+     *
+     * @code
+     * MyDialog *d = new MyDialog(this);
+     * d->setAttribute(Qt::WA_DeleteOnClose);
+     * d->execAsync([this](int result) { if (result==QDialog::Accepted) ... });
+     * @endcode
+     *
+     * The function is called from the event loop after the dialog has
+     * finished, not from within @c QDialog::done(), so by that time the
+     * dialog state has already been saved and it is safe to show another
+     * dialog or to delete this one.  The function is only called once,
+     * and it is not called if the dialog is deleted before it is finished.
+     * If the dialog has the @c Qt::WA_DeleteOnClose attribute set then it
+     * may already have been deleted when the function is called, so it
+     * should retrieve anything that it needs from the dialog by capturing
+     * it in the function.
+     *
+     * @param done The function to call when the dialog is finished
+     **/
+    void execAsync(const std::function<void(int)> &done);
+
+    /**
+     * @reimp
+     *
+     * When the dialog is about to be shown, the layout is set up and
+     * the saved state is restored before the window is shown.  The dialog
+     * then appears at its restored size with a single layout pass.
+     **/
+    void setVisible(bool visible) override;
+
 protected:
     /**
      * Constructor.
@@ -220,10 +459,28 @@ protected:
      **/
     void showEvent(QShowEvent *ev) override;
 
+    /**
+     * @reimp
+     **/
+    bool event(QEvent *ev) override;
+
+private:
+    void setupLayout();
+    QDialogButtonBox *ensureButtonBox();
+    DialogStateWatcher *ensureStateWatcher();
+    void assignGuiItem(QPushButton *but, const KGuiItem &guiItem) const;
+
 private:
     QDialogButtonBox *mButtonBox;
+    QDialogButtonBox::StandardButtons mPendingButtons;
     QWidget *mMainWidget;
     DialogStateWatcher *mStateWatcher;
+    DialogStateSaver *mPendingSaver;
+    bool mPendingSaverSet;
+    int mUpdateDepth;
+    bool mUpdatesWereEnabled;
+    int mLayoutPasses;
+    int mResizeEvents;
 };
 
 #endif							// DIALOGBASE_H
@@ -0,0 +1,137 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include "dialogmanager.h"
+
+#include <qdialog.h>
+#include <qcoreapplication.h>
+
+#include "dialogstatewatcher.h"
+#include "dialogstatesaver.h"
+#include "libkfdialog_logging.h"
+
+
+DialogManager::DialogManager(QObject *pnt)
+    : QObject(pnt)
+{
+    mMaxHidden = 8;
+}
+
+
+DialogManager *DialogManager::self()
+{
+    static DialogManager *sInstance = nullptr;
+    if (sInstance==nullptr) sInstance = new DialogManager(QCoreApplication::instance());
+    return (sInstance);
+}
+
+
+QDialog *DialogManager::showDialog(const QString &key, const DialogManager::Factory &factory)
+{
+    QDialog *d = mDialogs.value(key);
+    if (d==nullptr)					// no existing instance
+    {
+        qCDebug(LIBKFDIALOG_LOG) << "creating" << key;
+        d = factory();
+        Q_ASSERT(d!=nullptr);
+
+        d->setModal(false);
+        d->setAttribute(Qt::WA_DeleteOnClose, false);	// we manage its lifetime
+        connect(d, &QDialog::finished, this, [this, key](int result) { dialogFinished(key, result); });
+        connect(d, &QObject::destroyed, this, [this, key]() { dialogDestroyed(key); });
+        mDialogs.insert(key, d);
+    }
+    else qCDebug(LIBKFDIALOG_LOG) << "reusing" << key;
+
+    mHidden.removeAll(key);				// it is now in use
+    if (!d->isVisible()) d->show();
+    d->raise();
+    d->activateWindow();
+    return (d);
+}
+
+
+QDialog *DialogManager::dialog(const QString &key) const
+{
+    return (mDialogs.value(key));
+}
+
+
+void DialogManager::setMaxHidden(int num)
+{
+    mMaxHidden = qMax(num, 0);
+    trimHidden();
+}
+
+
+void DialogManager::releaseHidden()
+{
+    qCDebug(LIBKFDIALOG_LOG) << "releasing" << mHidden.count() << "hidden";
+    const int max = mMaxHidden;
+    mMaxHidden = 0;
+    trimHidden();
+    mMaxHidden = max;
+}
+
+
+void DialogManager::dialogFinished(const QString &key, int result)
+{
+    QDialog *d = mDialogs.value(key);
+    if (d==nullptr) return;
+
+    // The state watcher will already have saved the state if the
+    // dialogue was accepted.  If it was not, then the settings are
+    // not saved, but the window size is so that it is not lost if the
+    // hidden instance is deleted before it is next shown.
+    if (result!=QDialog::Accepted)
+    {
+        const DialogStateWatcher *watcher = d->findChild<DialogStateWatcher *>(QString(), Qt::FindDirectChildrenOnly);
+        if (watcher!=nullptr && watcher->stateSaver()!=nullptr) DialogStateSaver::saveWindowState(d);
+    }
+
+    mHidden.removeAll(key);
+    mHidden.prepend(key);				// most recently used first
+    trimHidden();
+}
+
+
+void DialogManager::dialogDestroyed(const QString &key)
+{
+    qCDebug(LIBKFDIALOG_LOG) << "destroyed" << key;
+    mDialogs.remove(key);
+    mHidden.removeAll(key);
+}
+
+
+void DialogManager::trimHidden()
+{
+    while (mHidden.count()>mMaxHidden)			// too many hidden
+    {
+        const QString key = mHidden.takeLast();		// least recently used
+        QDialog *d = mDialogs.take(key);
+        if (d==nullptr) continue;
+
+        qCDebug(LIBKFDIALOG_LOG) << "deleting hidden" << key;
+        d->disconnect(this);
+        d->deleteLater();
+    }
+}
@@ -0,0 +1,149 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#ifndef DIALOGMANAGER_H
+#define DIALOGMANAGER_H
+
+#include <functional>
+
+#include <qobject.h>
+#include <qstringlist.h>
+#include <qhash.h>
+
+#include "libkfdialog_export.h"
+
+class QDialog;
+class QWidget;
+
+
+/**
+ * @short Manage modeless dialogues which are reused instead of recreated.
+ *
+ * An application's tool dialogues may be opened many times, and creating
+ * a new instance each time means constructing all of the dialogue's
+ * widgets and restoring its state again.  This manager keeps at most one
+ * instance of each dialogue, identified by a key.  When the dialogue is
+ * requested again, the existing instance is shown if it is hidden and
+ * then raised and activated.
+ *
+ * Hidden dialogues are kept for reuse, up to a limit, with the least
+ * recently used being deleted if there are too many.  All of the hidden
+ * dialogues can also be deleted if the application is short of memory.
+ *
+ * The dialogue's size and state is restored by its DialogStateWatcher
+ * each time that it is shown, as normal, and saved only if it is accepted.
+ * If it is closed without being accepted then only the window size is
+ * saved, because the instance may be deleted while it is hidden.
+ *
+ * @code
+ * MyToolDialog *d = DialogManager::self()->showDialog<MyToolDialog>("tool", this);
+ * @endcode
+ *
+ * @author Jonathan Marten
+ **/
+
+class LIBKFDIALOG_EXPORT DialogManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * A function which creates a new instance of a dialogue.
+     **/
+    typedef std::function<QDialog *()> Factory;
+
+    /**
+     * Access the dialog manager.
+     *
+     * @return the application-wide dialog manager
+     **/
+    static DialogManager *self();
+
+    /**
+     * Show a dialogue, creating it if necessary.
+     *
+     * If a dialogue with the specified key already exists then it is
+     * shown if it is not already visible, and raised and activated.
+     * Otherwise the factory is called to create a new instance, which
+     * is set to be modeless and shown.
+     *
+     * @param key Key identifying the dialogue
+     * @param factory Function to create the dialogue if required
+     * @return the dialogue
+     **/
+    QDialog *showDialog(const QString &key, const DialogManager::Factory &factory);
+
+    /**
+     * Show a dialogue of a particular class, creating it if necessary.
+     *
+     * This is a convenience for the common case where the dialogue's
+     * constructor takes only a parent widget.
+     *
+     * @param key Key identifying the dialogue
+     * @param pnt Parent widget for a new dialogue
+     * @return the dialogue
+     **/
+    template<class T> T *showDialog(const QString &key, QWidget *pnt = nullptr)
+    {
+        return (static_cast<T *>(showDialog(key, [pnt]() -> QDialog * { return (new T(pnt)); })));
+    }
+
+    /**
+     * Find an existing dialogue.
+     *
+     * @param key Key identifying the dialogue
+     * @return the dialogue, or @c nullptr if there is no instance
+     **/
+    QDialog *dialog(const QString &key) const;
+
+    /**
+     * Set the maximum number of hidden dialogues kept for reuse.
+     *
+     * The default is 8.
+     *
+     * @param num The maximum number of hidden dialogues
+     **/
+    void setMaxHidden(int num);
+
+    /**
+     * Delete all of the dialogues which are currently hidden.
+     *
+     * This may be called if the application is short of memory.
+     * They will be created again when they are next required.
+     **/
+    void releaseHidden();
+
+private:
+    explicit DialogManager(QObject *pnt = nullptr);
+    ~DialogManager() override = default;
+
+    void dialogFinished(const QString &key, int result);
+    void dialogDestroyed(const QString &key);
+    void trimHidden();
+
+private:
+    QHash<QString, QDialog *> mDialogs;
+    QStringList mHidden;
+    int mMaxHidden;
+};
+
+#endif							// DIALOGMANAGER_H
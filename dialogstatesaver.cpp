@@ -25,24 +25,57 @@
 #include <qdialog.h>
 #include <qwindow.h>
 #include <qscreen.h>
+#include <qhash.h>
+#include <qstandardpaths.h>
+#include <qdatetime.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qtimer.h>
+#include <qatomic.h>
+#include <qcursor.h>
+#include <qguiapplication.h>
+#include <algorithm>
 
 #include <kconfiggroup.h>
 #include <ksharedconfig.h>
 
+#include "geometryindex.h"
+#include "operationwatchdog.h"
 #include "libkfdialog_logging.h"
 
 
 static bool sSaveSettings = true;
+static QAtomicInt sInstances = 0;
+static bool sShardedStorage = false;
+
+// The configuration files for sharded storage, indexed by group name.
+// They are kept open so that each file is only read once.
+static QHash<QString, KSharedConfig::Ptr> sShardConfigs;
+
+static bool sCompactionScheduled = false;
 
 
 DialogStateSaver::DialogStateSaver(QDialog *pnt)
 {
     Q_ASSERT(pnt!=nullptr);
     mParent = pnt;
+    sInstances.ref();
+}
+
+
+DialogStateSaver::~DialogStateSaver()
+{
+    sInstances.deref();
 }
 
 
-static KConfigGroup configGroupFor(QWidget *window)
+int DialogStateSaver::instanceCount()
+{
+    return (sInstances.load());
+}
+
+
+static QString groupNameFor(const QWidget *window)
 {
     QString objName = window->objectName();
     if (objName.isEmpty())
@@ -52,15 +85,80 @@ static KConfigGroup configGroupFor(QWidget *window)
     }
     else qCDebug(LIBKFDIALOG_LOG) << "for" << objName << "which is a" << window->metaObject()->className();
 
-    return (KSharedConfig::openConfig(QString(), KConfig::NoCascade)->group(objName));
+    return (objName);
+}
+
+
+static QString shardDirectory()
+{
+    return (QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation)+"/dialogs");
+}
+
+
+static KSharedConfig::Ptr shardConfigFor(const QString &groupName)
+{
+    QHash<QString, KSharedConfig::Ptr>::const_iterator it = sShardConfigs.constFind(groupName);
+    if (it!=sShardConfigs.constEnd()) return (it.value());
+
+    // The group name is an object or class name, but may contain
+    // characters that are not wanted in a file name.  If two names
+    // map to the same file then they still use different groups.
+    QString fileName = groupName;
+    for (QChar &ch : fileName)
+    {
+        if (!ch.isLetterOrNumber() && ch!='_' && ch!='-') ch = '_';
+    }
+
+    const QString filePath = shardDirectory()+'/'+fileName+"rc";
+    qCDebug(LIBKFDIALOG_LOG) << "shard for" << groupName << "is" << filePath;
+
+    KSharedConfig::Ptr config = KSharedConfig::openConfig(filePath, KConfig::SimpleConfig);
+    sShardConfigs.insert(groupName, config);
+    return (config);
+}
+
+
+static KConfigGroup configGroupFor(const QString &groupName, bool forRestore)
+{
+    if (sShardedStorage)
+    {
+        KConfigGroup grp = shardConfigFor(groupName)->group(groupName);
+        // Always save to the shard, but if nothing has been saved there
+        // yet then restore from the application config file.
+        if (!forRestore || grp.exists()) return (grp);
+    }
+
+    return (KSharedConfig::openConfig(QString(), KConfig::NoCascade)->group(groupName));
+}
+
+
+static KConfigGroup configGroupFor(const QWidget *window, bool forRestore)
+{
+    return (configGroupFor(groupNameFor(window), forRestore));
+}
+
+
+KConfigGroup DialogStateSaver::configGroup(bool forRestore) const
+{
+    // The group name is only worked out again if the object
+    // name of the dialog has changed since it was last used.
+    const QString objName = mParent->objectName();
+    if (mGroupName.isEmpty() || objName!=mObjectName)
+    {
+        mObjectName = objName;
+        mGroupName = groupNameFor(mParent);
+    }
+
+    return (configGroupFor(mGroupName, forRestore));
 }
 
 
 void DialogStateSaver::restoreConfig()
 {
     if (!sSaveSettings) return;				// settings not to be restored
+    OperationWatchdog::Scope scope("DialogStateSaver::restoreConfig", mParent->objectName());
 
-    const KConfigGroup grp = configGroupFor(mParent);
+    const KConfigGroup grp = configGroup(true);
     this->restoreConfig(mParent, grp);
 }
 
@@ -73,24 +171,70 @@ void DialogStateSaver::restoreConfig(QDialog *dialog, const KConfigGroup &grp)
 
 void DialogStateSaver::restoreWindowState(QWidget *widget)
 {
-    const KConfigGroup grp = configGroupFor(widget);
+    OperationWatchdog::Scope scope("DialogStateSaver::restoreWindowState", widget->objectName());
+    const KConfigGroup grp = configGroupFor(widget, true);
     restoreWindowState(widget, grp);
 }
 
 
+// The screen that a window will be shown on.  If it is not shown yet,
+// then the state is being restored before QDialog::adjustPosition() has
+// moved it, so its window handle is still on the primary or previous
+// screen.  In that case this follows adjustPosition(), which places the
+// window over its parent or, if it has none, on the screen with the
+// mouse pointer.  The window handle is moved to that screen as well,
+// so that the restored size is for the screen that it will appear on.
+static QScreen *screenForWindow(QWidget *window)
+{
+    QWindow *handle = window->windowHandle();
+    if (window->isVisible()) return (handle->screen());
+
+    QScreen *screen = nullptr;
+    const QWidget *pnt = window->parentWidget();
+    if (pnt!=nullptr) screen = pnt->window()->screen();
+    else screen = QGuiApplication::screenAt(QCursor::pos());
+    if (screen==nullptr) return (handle->screen());	// cannot tell, use current
+
+    if (screen!=handle->screen())
+    {
+        qCDebug(LIBKFDIALOG_LOG) << "moving to screen" << screen->name();
+        handle->setScreen(screen);
+    }
+    return (screen);
+}
+
+
 void DialogStateSaver::restoreWindowState(QWidget *widget, const KConfigGroup &grp)
 {
     // Ensure that the widget's window() - that is, either the widget itself
     // or its nearest ancestor widget that is or could be top level - is a
     // native window, so that windowHandle() below will return a valid QWindow.
     const WId wid = widget->window()->winId();
-    const QRect desk = widget->window()->windowHandle()->screen()->geometry();
-    const QSize sizeDefault = widget->sizeHint();
-
-    // originally from KDE4 KDialog::restoreDialogSize()
+    QScreen *screen = screenForWindow(widget->window());
     qCDebug(LIBKFDIALOG_LOG) << "from" << grp.name() << "in" << grp.config()->name();
-    const int width = grp.readEntry(QString::fromLatin1("Width %1").arg(desk.width()), sizeDefault.width());
-    const int height = grp.readEntry(QString::fromLatin1("Height %1").arg(desk.height()), sizeDefault.height());
+
+    QSize size;
+    if (GeometryIndex::lookup(grp, screen, &size))	// saved for this or a similar screen
+    {
+        widget->resize(size);
+        return;
+    }
+
+    // Not in the index, so try the old-style entries saved by
+    // previous versions.  Originally from KDE4 KDialog::restoreDialogSize()
+    //
+    // The size hint is only used as the default if there is no saved
+    // value, and for a complex dialog it may need a full layout calculation,
+    // so it is only evaluated if actually required.
+    const GeometryIndex::Keys keys = GeometryIndex::keysFor(screen);
+    const bool haveWidth = grp.hasKey(keys.width);
+    const bool haveHeight = grp.hasKey(keys.height);
+
+    QSize sizeDefault;
+    if (!haveWidth || !haveHeight) sizeDefault = widget->sizeHint();
+
+    const int width = haveWidth ? grp.readEntry(keys.width, 0) : sizeDefault.width();
+    const int height = haveHeight ? grp.readEntry(keys.height, 0) : sizeDefault.height();
     widget->resize(width, height);
 }
 
@@ -98,8 +242,9 @@ void DialogStateSaver::restoreWindowState(QWidget *widget, const KConfigGroup &g
 void DialogStateSaver::saveConfig() const
 {
     if (!sSaveSettings) return;				// settings not to be saved
+    OperationWatchdog::Scope scope("DialogStateSaver::saveConfig", mParent->objectName());
 
-    KConfigGroup grp = configGroupFor(mParent);
+    KConfigGroup grp = configGroup(false);
     this->saveConfig(mParent, grp);
     grp.sync();
 }
@@ -113,7 +258,8 @@ void DialogStateSaver::saveConfig(QDialog *dialog, KConfigGroup &grp) const
 
 void DialogStateSaver::saveWindowState(QWidget *widget)
 {
-    KConfigGroup grp = configGroupFor(widget);
+    OperationWatchdog::Scope scope("DialogStateSaver::saveWindowState", widget->objectName());
+    KConfigGroup grp = configGroupFor(widget, false);
     saveWindowState(widget, grp);
 }
 
@@ -121,13 +267,11 @@ void DialogStateSaver::saveWindowState(QWidget *widget)
 void DialogStateSaver::saveWindowState(QWidget *widget, KConfigGroup &grp)
 {
     const WId wid = widget->window()->winId();
-    const QRect desk = widget->window()->windowHandle()->screen()->geometry();
+    QScreen *screen = widget->window()->windowHandle()->screen();
     const QSize sizeToSave = widget->size();
 
-    // originally from KDE4 KDialog::saveDialogSize()
     qCDebug(LIBKFDIALOG_LOG) << "to" << grp.name() << "in" << grp.config()->name();
-    grp.writeEntry(QString::fromLatin1("Width %1").arg(desk.width()), sizeToSave.width());
-    grp.writeEntry( QString::fromLatin1("Height %1").arg(desk.height()), sizeToSave.height());
+    GeometryIndex::store(grp, screen, sizeToSave);
     grp.sync();
 }
 
@@ -136,3 +280,108 @@ void DialogStateSaver::setSaveSettingsDefault(bool on)
 {
     sSaveSettings = on;
 }
+
+
+void DialogStateSaver::setShardedStorage(bool on)
+{
+    sShardedStorage = on;
+}
+
+
+struct CompactEntry
+{
+    KSharedConfig::Ptr config;
+    QString groupName;
+    qint64 lastUsed;
+};
+
+
+static void deleteGroup(const CompactEntry &entry)
+{
+    qCDebug(LIBKFDIALOG_LOG) << "remove" << entry.groupName << "from" << entry.config->name();
+    KConfigGroup grp = entry.config->group(entry.groupName);
+    grp.deleteGroup();
+}
+
+
+void DialogStateSaver::compactConfig(int maxAgeDays, int maxDialogs)
+{
+    OperationWatchdog::Scope scope("DialogStateSaver::compactConfig");
+    const qint64 cutoff = QDateTime::currentSecsSinceEpoch()-qint64(maxAgeDays)*24*60*60;
+
+    QList<KSharedConfig::Ptr> configs;
+    configs.append(KSharedConfig::openConfig(QString(), KConfig::NoCascade));
+
+    // The dialogs' own files are compacted even if sharded storage
+    // is not being used at the moment, in case it was previously.
+    const QDir shardDir(shardDirectory());
+    const QStringList shardFiles = shardDir.entryList(QStringList("*rc"), QDir::Files);
+    for (const QString &file : shardFiles)
+    {
+        configs.append(KSharedConfig::openConfig(shardDir.absoluteFilePath(file), KConfig::SimpleConfig));
+    }
+
+    // Remove groups which are too old, and collect the others
+    QVector<CompactEntry> entries;
+    for (const KSharedConfig::Ptr &config : qAsConst(configs))
+    {
+        const QStringList groups = config->groupList();
+        for (const QString &groupName : groups)
+        {
+            KConfigGroup grp = config->group(groupName);
+            qint64 lastUsed;
+            if (!GeometryIndex::compact(grp, cutoff, &lastUsed)) continue;
+
+            const CompactEntry entry { config, groupName, lastUsed };
+            if (lastUsed<cutoff) deleteGroup(entry);
+            else entries.append(entry);
+        }
+    }
+
+    // Then remove the least recently used if there are too many
+    if (entries.count()>maxDialogs)
+    {
+        std::sort(entries.begin(), entries.end(),
+                  [](const CompactEntry &a, const CompactEntry &b) { return (a.lastUsed>b.lastUsed); });
+        for (int i = qMax(maxDialogs, 0); i<entries.count(); ++i) deleteGroup(entries.at(i));
+    }
+
+    for (const KSharedConfig::Ptr &config : qAsConst(configs))
+    {
+        config->sync();
+        if (config==configs.first() || !config->groupList().isEmpty()) continue;
+
+        // A dialog's own file that is now empty
+        for (QHash<QString, KSharedConfig::Ptr>::iterator it = sShardConfigs.begin(); it!=sShardConfigs.end(); )
+        {
+            if (it.value()==config) it = sShardConfigs.erase(it);
+            else ++it;
+        }
+        QFile::remove(config->name());
+    }
+
+    qCDebug(LIBKFDIALOG_LOG) << "compacted, kept" << qMin(entries.count(), maxDialogs) << "of" << entries.count();
+}
+
+
+void DialogStateSaver::scheduleCompaction(int maxAgeDays, int maxDialogs)
+{
+    if (sCompactionScheduled) return;			// already scheduled or done
+    sCompactionScheduled = true;
+
+    // A zero timer fires once all pending events have been processed
+    QTimer::singleShot(0, [maxAgeDays, maxDialogs]() { compactConfig(maxAgeDays, maxDialogs); });
+}
+
+
+void DialogStateSaver::setMaxScreenConfigs(int num)
+{
+    GeometryIndex::setMaxScreens(num);
+}
+
+
+QString DialogStateSaver::screenConfigKey(QWidget *widget)
+{
+    widget->window()->winId();				// ensure a native window
+    return (GeometryIndex::keysFor(widget->window()->windowHandle()->screen()).screen);
+}
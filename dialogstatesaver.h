@@ -23,6 +23,8 @@
 #ifndef DIALOGSTATESAVER_H
 #define DIALOGSTATESAVER_H
 
+#include <qstring.h>
+
 #include "libkfdialog_export.h"
 
 class QDialog;
@@ -61,7 +63,19 @@ public:
     /**
      * Destructor.
      **/
-    virtual ~DialogStateSaver() = default;
+    virtual ~DialogStateSaver();
+
+    /**
+     * Get the number of DialogStateSaver instances which currently exist.
+     *
+     * This is for instrumentation, in order to check that savers are
+     * being deleted when their dialog is.  A default saver created by a
+     * DialogStateWatcher is deleted with the watcher, but one set by
+     * @c DialogStateWatcher::setStateSaver() is the caller's responsibility.
+     *
+     * @return the number of instances
+     **/
+    static int instanceCount();
 
     /**
      * Set the default option of whether the size of dialog boxes
@@ -74,13 +88,94 @@ public:
      * @note The setting is saved in the application's default configuration
      * file (as used by @c KSharedConfig::openConfig()) in a section named
      * by the dialog's object name.  If no object name is set then the
-     * dialog's class name is used.
+     * dialog's class name is used.  See @c setShardedStorage() for an
+     * alternative.
      *
      * @see KSharedConfig
      * @see QObject::objectName()
      **/
     static void setSaveSettingsDefault(bool on);
 
+    /**
+     * Set the maximum number of screen configurations for which the
+     * size of each window is remembered.  This is an application-wide
+     * setting, and the default is 4.
+     *
+     * A window's size is saved separately for each combination of screen
+     * resolution and DPI that it is shown on.  When it is shown on a
+     * screen configuration that has not been seen before, the size saved
+     * for the nearest known configuration is scaled to suit.  When a
+     * size is saved and there are more than this number of configurations
+     * recorded, the least recently used is forgotten.
+     *
+     * @param num The maximum number of screen configurations
+     **/
+    static void setMaxScreenConfigs(int num);
+
+    /**
+     * Set whether the state of each dialog box is saved in its own file.
+     * This is an application-wide setting, and the default is @c false.
+     *
+     * Normally the state of all dialogs is saved in the application's
+     * default configuration file.  Saving the state of any dialog locks
+     * and rewrites the whole of that file, so if there are many instances
+     * of the application running then they may have to wait for each other.
+     * If this option is set, then the state of each dialog is saved in a
+     * small file of its own in a @c dialogs subdirectory of the
+     * application's configuration directory (see
+     * @c QStandardPaths::AppConfigLocation).  Saving the state of one
+     * dialog then never has to wait for another.
+     *
+     * If there is no state saved in the dialog's own file, then it is
+     * restored from the application's default configuration file as
+     * before.  The state is always saved to the dialog's own file.
+     *
+     * @param on Whether the state of each dialog is saved separately
+     *
+     * @note This should be set before any dialog is shown, and should
+     * not be changed while the application is running.
+     **/
+    static void setShardedStorage(bool on);
+
+    /**
+     * Remove old saved dialog states from the application config file,
+     * and from the dialogs' own files if @c setShardedStorage() is used.
+     *
+     * Each time that the state of a dialog is saved, the time is recorded
+     * for the dialog and for the screen configuration that it is shown on.
+     * Dialogs which have not been saved within the specified age are
+     * removed completely, as are screen configurations for the remaining
+     * dialogs (apart from the most recently used).  If there are still
+     * more than the specified number of dialogs, then the least recently
+     * used are removed.
+     *
+     * Only configuration groups that are recognised as holding a saved
+     * dialog size are touched.  Groups for dialogs that have been removed
+     * or renamed will therefore eventually be removed.  A group is only
+     * recognised once it has been saved by this version of the library,
+     * which marks it with a key specific to the library.  Any other
+     * groups, including the application's own and those with only
+     * old-style width and height entries which are also saved by
+     * KWindowConfig, are never touched.
+     *
+     * @param maxAgeDays The maximum age, in days
+     * @param maxDialogs The maximum number of dialogs
+     *
+     * @note This reads and may rewrite the whole of the config files, so it
+     * should not be done often.  See @c scheduleCompaction().
+     **/
+    static void compactConfig(int maxAgeDays = 365, int maxDialogs = 100);
+
+    /**
+     * Arrange for @c compactConfig() to be done when the application
+     * event loop is next idle.  This is only done once per application
+     * run, however many times this is called.
+     *
+     * @param maxAgeDays The maximum age, in days
+     * @param maxDialogs The maximum number of dialogs
+     **/
+    static void scheduleCompaction(int maxAgeDays = 365, int maxDialogs = 100);
+
     /**
      * Save the parent dialog size to the application config file.
      *
@@ -147,6 +242,19 @@ public:
      **/
     static void restoreWindowState(QWidget *widget, const KConfigGroup &grp);
 
+    /**
+     * Get a key identifying the screen configuration that a window is shown on.
+     *
+     * This is the screen resolution and DPI, in the same form as used for
+     * saving the window size.  It may be used by a subclass to save other
+     * settings which depend on the screen configuration.  The key string
+     * is generated once for each screen and is then shared.
+     *
+     * @param widget window to get the key for
+     * @return the screen configuration key
+     **/
+    static QString screenConfigKey(QWidget *widget);
+
 protected:
     /**
      * Save the dialog size to the application config file.
@@ -154,6 +262,8 @@ protected:
      * This may be reimplemented in a subclass if necessary, in order
      * to save other settings (e.g. the column states of a list view).
      * Call the base class implementation to save the dialog size.
+     * Giving the keys as @c QStringLiteral means that no string needs
+     * to be allocated each time that the setting is saved.
      *
      * @param dialog dialog to save the state of
      * @param grp group to save the configuration to
@@ -172,8 +282,13 @@ protected:
      **/
     virtual void restoreConfig(QDialog *dialog, const KConfigGroup &grp);
 
+private:
+    KConfigGroup configGroup(bool forRestore) const;
+
 private:
     QDialog *mParent;
+    mutable QString mObjectName;
+    mutable QString mGroupName;
 };
 
 #endif							// DIALOGSTATESAVER_H
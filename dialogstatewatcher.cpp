@@ -40,8 +40,29 @@ DialogStateWatcher::DialogStateWatcher(QDialog *pnt)
     mParent->installEventFilter(this);
     connect(mParent, &QDialog::accepted, this, &DialogStateWatcher::saveConfigInternal);
 
-    mStateSaver = new DialogStateSaver(mParent);	// use our own as default
-    mHaveOwnSaver = true;				// note that we created it
+    mStateSaver = nullptr;				// default created when needed
+    mHaveOwnSaver = false;
+    mSaverSet = false;
+    mRestored = false;					// not restored yet
+}
+
+
+DialogStateWatcher::~DialogStateWatcher()
+{
+    if (mHaveOwnSaver) delete mStateSaver;		// only if we created it
+}
+
+
+DialogStateSaver *DialogStateWatcher::stateSaver() const
+{
+    if (!mSaverSet)					// none set explicitly
+    {
+        mStateSaver = new DialogStateSaver(mParent);	// use our own as default
+        mHaveOwnSaver = true;				// note that we created it
+        mSaverSet = true;
+    }
+
+    return (mStateSaver);
 }
 
 
@@ -54,25 +75,37 @@ void DialogStateWatcher::setSaveOnButton(QAbstractButton *but)
 
 bool DialogStateWatcher::eventFilter(QObject *obj, QEvent *ev)
 {
-    if (obj==mParent && ev->type()==QEvent::Show)	// only interested in show event
+    if (obj==mParent)
     {
-        restoreConfigInternal();			// restore size and config
+        if (ev->type()==QEvent::Show) restoreConfig();	// restore if not done already
+        else if (ev->type()==QEvent::Hide) mRestored = false;
     }
     return (false);					// always pass the event on
 }
 
 
+void DialogStateWatcher::restoreConfig()
+{
+    if (mRestored) return;				// already done for this show
+    mRestored = true;
+    restoreConfigInternal();				// restore size and config
+}
+
+
 void DialogStateWatcher::restoreConfigInternal()
 {
-    if (mStateSaver==nullptr) return;			// no saver set or provided
-    mStateSaver->restoreConfig();
+    DialogStateSaver *saver = stateSaver();
+    if (saver==nullptr) return;				// no saver set or provided
+
+    saver->restoreConfig();
 }
 
 
 void DialogStateWatcher::saveConfigInternal() const
 {
-    if (mStateSaver==nullptr) return;			// no saver set or provided
-    mStateSaver->saveConfig();
+    DialogStateSaver *saver = stateSaver();
+    if (saver==nullptr) return;				// no saver set or provided
+    saver->saveConfig();
 }
 
 
@@ -83,4 +116,5 @@ void DialogStateWatcher::setStateSaver(DialogStateSaver *saver)
 
     mStateSaver = saver;				// set the new one
     mHaveOwnSaver = false;				// note that it's not ours
+    mSaverSet = true;
 }
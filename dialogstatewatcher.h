@@ -62,8 +62,10 @@ public:
 
     /**
      * Destructor.
+     *
+     * The default state saver is deleted, if one was created.
      **/
-    ~DialogStateWatcher() override = default;
+    ~DialogStateWatcher() override;
 
     /**
      * Set a state saver for the dialog being watched.
@@ -91,10 +93,11 @@ public:
      * Access the state saver used by the watcher.
      *
      * This may be the default one, or that set by @c setStateSaver().
+     * The default saver is only created when it is first needed.
      *
      * @return the state saver
      **/
-    DialogStateSaver *stateSaver() const		{ return (mStateSaver); }
+    DialogStateSaver *stateSaver() const;
 
     /**
      * Sets a button to save the state of the dialog when it is used.
@@ -115,6 +118,21 @@ public:
      */
     void setSaveOnButton(QAbstractButton *but);
 
+    /**
+     * Restore the state of the dialog now.
+     *
+     * Normally the state is restored when the dialog receives its show
+     * event.  By then the window has already been sized and laid out, so
+     * restoring the size causes a second resize, layout pass and repaint.
+     * Calling this function before the dialog is shown avoids that, and
+     * the restore at the show event is then skipped.  DialogBase does this
+     * automatically.
+     *
+     * The state is only restored once each time the dialog is shown,
+     * however many times this is called.
+     **/
+    void restoreConfig();
+
 protected:
     /**
      * @reimp
@@ -127,8 +145,10 @@ private slots:
 
 private:
     QDialog *mParent;
-    DialogStateSaver *mStateSaver;
-    bool mHaveOwnSaver;
+    mutable DialogStateSaver *mStateSaver;
+    mutable bool mHaveOwnSaver;
+    mutable bool mSaverSet;
+    bool mRestored;
 };
 
 #endif							// DIALOGSTATEWATCHER_H
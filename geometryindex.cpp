@@ -0,0 +1,299 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include "geometryindex.h"
+
+#include <climits>
+
+#include <qscreen.h>
+#include <qstringlist.h>
+#include <qhash.h>
+#include <qset.h>
+#include <qdatetime.h>
+#include <qregularexpression.h>
+
+#include <kconfiggroup.h>
+
+#include "libkfdialog_logging.h"
+
+
+static int sMaxScreens = 4;
+
+// The time that the group was last saved.  The key is specific to this
+// library, because it also marks the group as one that compact() may
+// change or delete.  Other keys such as "Screens" could also be used by
+// an application's own groups.
+static const char sLastUsedKey[] = "KFDialog Last Used";
+
+
+struct ScreenConfig
+{
+    int width;
+    int height;
+    int dpi;
+};
+
+
+// Interned configuration keys for each screen, so that they do not
+// need to be formatted every time that a window is saved or restored.
+// An entry is removed if the screen changes or goes away.
+struct ScreenEntry
+{
+    ScreenConfig config;
+    GeometryIndex::Keys keys;
+};
+
+static QHash<const QScreen *, ScreenEntry> sScreenEntries;
+
+// Screens which have had their signals connected to invalidate
+// the entry.  This is only done once for each screen, however many
+// times its entry is rebuilt.
+static QSet<const QScreen *> sConnectedScreens;
+
+
+static ScreenConfig screenConfigFor(const QScreen *screen)
+{
+    const QRect desk = screen->geometry();
+    return (ScreenConfig { desk.width(), desk.height(), qRound(screen->logicalDotsPerInch()) });
+}
+
+
+static QString keyFor(const ScreenConfig &cfg)
+{
+    return (QString::fromLatin1("%1x%2@%3").arg(cfg.width).arg(cfg.height).arg(cfg.dpi));
+}
+
+
+static bool parseKey(const QString &key, ScreenConfig *cfg)
+{
+    const int xpos = key.indexOf('x');
+    const int atpos = key.indexOf('@');
+    if (xpos<1 || atpos<xpos) return (false);		// not a valid screen key
+
+    bool ok1, ok2, ok3;
+    cfg->width = key.left(xpos).toInt(&ok1);
+    cfg->height = key.mid(xpos+1, atpos-xpos-1).toInt(&ok2);
+    cfg->dpi = key.mid(atpos+1).toInt(&ok3);
+    return (ok1 && ok2 && ok3 && cfg->width>0 && cfg->height>0);
+}
+
+
+static inline QString sizeKey(const QString &screenKey)
+{
+    return (QLatin1String("Size ")+screenKey);
+}
+
+
+static inline QString usedKey(const QString &screenKey)
+{
+    return (QLatin1String("Used ")+screenKey);
+}
+
+
+// Whether a key is an old-style width or height entry
+static bool isLegacyKey(const QString &key)
+{
+    static const QRegularExpression rx(QStringLiteral("^(Width|Height) \\d+$"));
+    return (rx.match(key).hasMatch());
+}
+
+
+static const ScreenEntry &entryFor(QScreen *screen)
+{
+    QHash<const QScreen *, ScreenEntry>::const_iterator it = sScreenEntries.constFind(screen);
+    if (it!=sScreenEntries.constEnd()) return (it.value());
+
+    ScreenEntry entry;
+    entry.config = screenConfigFor(screen);
+    entry.keys.screen = keyFor(entry.config);
+    entry.keys.size = sizeKey(entry.keys.screen);
+    entry.keys.used = usedKey(entry.keys.screen);
+    entry.keys.width = QString::fromLatin1("Width %1").arg(entry.config.width);
+    entry.keys.height = QString::fromLatin1("Height %1").arg(entry.config.height);
+    qCDebug(LIBKFDIALOG_LOG) << "new screen" << screen->name() << "key" << entry.keys.screen;
+
+    // The connections are removed automatically when the screen is destroyed
+    if (!sConnectedScreens.contains(screen))
+    {
+        auto forget = [screen]() { sScreenEntries.remove(screen); };
+        QObject::connect(screen, &QScreen::geometryChanged, forget);
+        QObject::connect(screen, &QScreen::logicalDotsPerInchChanged, forget);
+        QObject::connect(screen, &QObject::destroyed, [screen]()
+        {
+            sScreenEntries.remove(screen);
+            sConnectedScreens.remove(screen);
+        });
+        sConnectedScreens.insert(screen);
+    }
+
+    return (sScreenEntries.insert(screen, entry).value());
+}
+
+
+// The screen list is read from the group each time, rather than
+// being cached here.  KConfig already holds the entries in memory,
+// and the config object may be deleted and another one allocated
+// at the same address, or the file changed by another process.
+static QStringList screensFor(const KConfigGroup &grp)
+{
+    return (grp.readEntry("Screens", QStringList()));
+}
+
+
+GeometryIndex::Keys GeometryIndex::keysFor(QScreen *screen)
+{
+    return (entryFor(screen).keys);
+}
+
+
+bool GeometryIndex::lookup(const KConfigGroup &grp, QScreen *screen, QSize *size)
+{
+    const QStringList screens = screensFor(grp);
+    if (screens.isEmpty()) return (false);		// nothing saved in index
+
+    const ScreenEntry &entry = entryFor(screen);
+    const ScreenConfig &cur = entry.config;
+    const QString &curKey = entry.keys.screen;
+    if (screens.contains(curKey))			// exact match for this screen
+    {
+        const QSize saved = grp.readEntry(entry.keys.size, QSize());
+        if (saved.isValid())
+        {
+            *size = saved;
+            return (true);
+        }
+    }
+
+    // No exact match, so find the nearest known screen configuration.
+    // A difference in DPI counts as much as a sizeable difference in
+    // resolution, because the content will be laid out differently.
+    QString nearestKey;
+    ScreenConfig nearest = cur;
+    int nearestDist = INT_MAX;
+    for (const QString &key : screens)
+    {
+        ScreenConfig cfg;
+        if (!parseKey(key, &cfg)) continue;
+
+        const int dist = qAbs(cfg.width-cur.width)+qAbs(cfg.height-cur.height)+8*qAbs(cfg.dpi-cur.dpi);
+        if (dist<nearestDist)
+        {
+            nearestDist = dist;
+            nearestKey = key;
+            nearest = cfg;
+        }
+    }
+
+    if (nearestKey.isEmpty()) return (false);		// no usable entries
+    const QSize saved = grp.readEntry(sizeKey(nearestKey), QSize());
+    if (!saved.isValid()) return (false);
+
+    // Scale the saved size so that the window occupies the same proportion
+    // of the screen, but not more than the available screen area.
+    QSize scaled(qRound(double(saved.width())*cur.width/nearest.width),
+                 qRound(double(saved.height())*cur.height/nearest.height));
+    scaled = scaled.boundedTo(screen->availableGeometry().size());
+    qCDebug(LIBKFDIALOG_LOG) << "nearest" << nearestKey << "for" << curKey << "size" << saved << "->" << scaled;
+
+    *size = scaled;
+    return (true);
+}
+
+
+void GeometryIndex::store(KConfigGroup &grp, QScreen *screen, const QSize &size)
+{
+    const ScreenEntry &entry = entryFor(screen);
+    const QString &curKey = entry.keys.screen;
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    grp.writeEntry(entry.keys.size, size);
+    grp.writeEntry(entry.keys.used, now);
+    grp.writeEntry(sLastUsedKey, now);
+
+    QStringList screens = screensFor(grp);
+    screens.removeAll(curKey);				// move to most recently used
+    screens.prepend(curKey);
+    while (screens.count()>sMaxScreens)			// forget least recently used
+    {
+        const QString oldKey = screens.takeLast();
+        qCDebug(LIBKFDIALOG_LOG) << "expire" << oldKey;
+        grp.deleteEntry(sizeKey(oldKey));
+        grp.deleteEntry(usedKey(oldKey));
+    }
+    grp.writeEntry("Screens", screens);
+
+    // Remove any old-style entries, now superseded by the index
+    grp.deleteEntry(entry.keys.width);
+    grp.deleteEntry(entry.keys.height);
+}
+
+
+bool GeometryIndex::compact(KConfigGroup &grp, qint64 cutoff, qint64 *lastUsed)
+{
+    // Only a group which has been saved by the index is touched.  Any
+    // other group, even one with entries that look like the index's, may
+    // belong to the application or to KWindowConfig so it is left alone.
+    if (!grp.hasKey(sLastUsedKey)) return (false);
+
+    const QStringList keys = grp.keyList();
+    QStringList screens = screensFor(grp);
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+
+    if (!screens.isEmpty())
+    {
+        // Expire any screen configurations not used since the cutoff,
+        // apart from the most recently used.  If there is no timestamp
+        // then this is the first compaction since it was saved, so the
+        // age starts from now.
+        bool changed = false;
+        for (int i = screens.count()-1; i>0; --i)
+        {
+            const QString &key = screens.at(i);
+            const qint64 used = grp.readEntry(usedKey(key), qint64(0));
+            if (used==0) grp.writeEntry(usedKey(key), now);
+            else if (used<cutoff)
+            {
+                qCDebug(LIBKFDIALOG_LOG) << "expire" << key << "in" << grp.name();
+                grp.deleteEntry(sizeKey(key));
+                grp.deleteEntry(usedKey(key));
+                screens.removeAt(i);
+                changed = true;
+            }
+        }
+
+        if (changed) grp.writeEntry("Screens", screens);
+
+        // Old-style entries are never read once there is an index
+        for (const QString &key : keys)
+        {
+            if (isLegacyKey(key)) grp.deleteEntry(key);
+        }
+    }
+
+    *lastUsed = grp.readEntry(sLastUsedKey, now);
+    return (true);
+}
+
+
+void GeometryIndex::setMaxScreens(int num)
+{
+    sMaxScreens = qMax(num, 1);
+}
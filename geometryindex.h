@@ -0,0 +1,145 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#ifndef GEOMETRYINDEX_H
+#define GEOMETRYINDEX_H
+
+#include <qsize.h>
+#include <qstring.h>
+
+class QScreen;
+class KConfigGroup;
+
+
+/**
+ * @short Index of saved window sizes, keyed by screen configuration.
+ *
+ * This is an internal helper for DialogStateSaver and is not installed.
+ *
+ * A window's saved size is recorded against the geometry and logical
+ * DPI of the screen that it was shown on, as a single @c "Size <screen>"
+ * entry in the window's configuration group.  The group also holds a
+ * @c "Screens" list of the screen configurations that have been seen,
+ * most recently used first, which is limited in length so that the
+ * group does not grow indefinitely as new monitor layouts are used.
+ *
+ * When restoring on a screen configuration that has not been seen
+ * before, the saved size for the nearest known configuration is
+ * scaled to suit the current screen.
+ *
+ * Each screen configuration, and the group as a whole, also records
+ * the time that it was last saved so that old entries can be expired
+ * by @c compact().  The group's time is saved as a @c "KFDialog Last Used"
+ * entry, which also marks the group as one saved by the index.
+ *
+ * The index is only intended to be used from the GUI thread.
+ *
+ * @author Jonathan Marten
+ **/
+
+namespace GeometryIndex
+{
+    /**
+     * The configuration keys used for a screen.
+     **/
+    struct Keys
+    {
+        QString screen;					///< Screen configuration, @c "<width>x<height>@<dpi>"
+        QString size;					///< Saved size, @c "Size <screen>"
+        QString used;					///< Time last saved, @c "Used <screen>"
+        QString width;					///< Old-style width, @c "Width <width>"
+        QString height;					///< Old-style height, @c "Height <height>"
+    };
+
+    /**
+     * Get the configuration keys for a screen.
+     *
+     * The keys are generated once for each screen and cached, until
+     * the screen's geometry or DPI changes.
+     *
+     * @param screen The screen
+     * @return The keys
+     **/
+    Keys keysFor(QScreen *screen);
+
+    /**
+     * Look up the saved size for a screen.
+     *
+     * If there is a size saved for exactly the same screen configuration
+     * then that is returned.  Otherwise the size for the nearest known
+     * screen configuration, if there is one, is scaled in proportion
+     * to the screen size and limited to the available screen area.
+     *
+     * @param grp The configuration group to read from
+     * @param screen The screen that the window is to be shown on
+     * @param size Set to the size found
+     * @return @c true if a size was found, @c false if there is
+     * no saved size in the index.
+     **/
+    bool lookup(const KConfigGroup &grp, QScreen *screen, QSize *size);
+
+    /**
+     * Save the size for a screen.
+     *
+     * The screen configuration is marked as the most recently used,
+     * and if there are now too many then the least recently used are
+     * removed.  Any old-style @c "Width <w>" and @c "Height <h>" entries
+     * for the screen are also removed, having been superseded.
+     *
+     * @param grp The configuration group to write to
+     * @param screen The screen that the window is shown on
+     * @param size The size to be saved
+     **/
+    void store(KConfigGroup &grp, QScreen *screen, const QSize &size);
+
+    /**
+     * Compact a configuration group.
+     *
+     * Screen configurations that have not been saved since the cutoff
+     * time are removed, apart from the most recently used one, and any
+     * old-style entries superseded by the index are removed.  Screen
+     * configurations that have no timestamp are given the current time.
+     *
+     * Only a group which has been saved by @c store(), and so has a
+     * @c "KFDialog Last Used" entry, is recognised.  Other groups are left
+     * unchanged, even if they have entries with the same keys as the index
+     * or old-style entries, because they may belong to the application or
+     * have been saved by KWindowConfig.
+     *
+     * @param grp The configuration group to compact
+     * @param cutoff The cutoff time, in seconds since the epoch
+     * @param lastUsed Set to the time that the group was last saved
+     * @return @c true if the group holds a saved window size,
+     * @c false if it is not recognised
+     **/
+    bool compact(KConfigGroup &grp, qint64 cutoff, qint64 *lastUsed);
+
+    /**
+     * Set the maximum number of screen configurations that are
+     * remembered for each window.  The default is 4.
+     *
+     * @param num The maximum number of screen configurations
+     **/
+    void setMaxScreens(int num);
+}
+
+#endif							// GEOMETRYINDEX_H
@@ -0,0 +1,116 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include "iconcache.h"
+
+#include <qcache.h>
+#include <qpixmap.h>
+#include <qwidget.h>
+#include <qstyle.h>
+#include <qcoreapplication.h>
+
+#include "libkfdialog_logging.h"
+
+
+// Rendered icons, keyed by "<name> <size> <dpr>".  The cost
+// of each entry is the size of its pixmap in bytes.
+static QCache<QString, QPixmap> sIcons(2*1024*1024);
+
+// The icon theme that the cached icons were rendered from
+static QString sThemeName;
+
+
+// The pixmaps must not outlive the application
+static void clearAtExit()
+{
+    sIcons.clear();
+}
+
+
+QIcon IconCache::icon(const QString &iconName, const QWidget *widget)
+{
+    const int size = widget->style()->pixelMetric(QStyle::PM_ButtonIconSize, nullptr, widget);
+    return (icon(iconName, size, widget->devicePixelRatioF()));
+}
+
+
+QIcon IconCache::icon(const QString &iconName, int size, qreal dpr)
+{
+    if (iconName.isEmpty()) return (QIcon());
+
+    const QString themeName = QIcon::themeName();
+    if (themeName!=sThemeName)				// theme has changed,
+    {							// so cache is out of date
+        if (!sIcons.isEmpty()) qCDebug(LIBKFDIALOG_LOG) << "theme changed to" << themeName;
+        sIcons.clear();
+        sThemeName = themeName;
+    }
+
+    const QString key = iconName+' '+QString::number(size)+' '+QString::number(dpr);
+    const QPixmap *cached = sIcons.object(key);
+    if (cached!=nullptr) return (QIcon(*cached));	// already in cache
+
+    // Render the icon once at the required size and pixel ratio.  The
+    // icon returned shares the cached pixmap, so the cost charged is the
+    // memory actually held.  An icon not found in the theme is cached
+    // as a null pixmap, which gives a null icon, so that the theme is
+    // not searched for it again.
+    QPixmap pix;
+    const QIcon themeIcon = QIcon::fromTheme(iconName);
+    if (!themeIcon.isNull())
+    {
+        // With high DPI pixmaps enabled, QIcon::pixmap() renders at the
+        // application's pixel ratio and so may return a larger pixmap than
+        // requested.  It is then scaled down to the required pixel size.
+        const int pixSize = qRound(size*dpr);
+        pix = themeIcon.pixmap(pixSize);
+        if (pix.width()>pixSize || pix.height()>pixSize)
+        {
+            pix = pix.scaled(pixSize, pixSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        pix.setDevicePixelRatio(dpr);
+    }
+    else qCDebug(LIBKFDIALOG_LOG) << "icon" << iconName << "not found in theme";
+    const int cost = qMax(pix.width()*pix.height()*pix.depth()/8, 1);
+
+    static bool routineAdded = false;
+    if (!routineAdded)					// clear cache at exit
+    {
+        qAddPostRoutine(clearAtExit);
+        routineAdded = true;
+    }
+
+    sIcons.insert(key, new QPixmap(pix), cost);
+    return (QIcon(pix));				// null if pixmap is null
+}
+
+
+void IconCache::clear()
+{
+    sIcons.clear();
+}
+
+
+void IconCache::setCacheLimit(int bytes)
+{
+    sIcons.setMaxCost(qMax(bytes, 1));
+}
@@ -0,0 +1,90 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <qicon.h>
+#include <qstring.h>
+
+class QWidget;
+
+
+/**
+ * @short Process-wide cache of rendered theme icons.
+ *
+ * This is an internal helper for DialogBase and is not installed.
+ *
+ * Looking up a theme icon and rendering it, especially from an SVG
+ * source, is relatively expensive and would otherwise be done again
+ * for every button of every dialog that is created.  The cache holds
+ * each icon already rendered as a pixmap, keyed by the icon name, size
+ * and device pixel ratio, and has a memory budget counted in the bytes
+ * held by those pixmaps.  The least recently used pixmaps are discarded
+ * if the budget is exceeded.
+ *
+ * If the icon theme changes, then all of the cached pixmaps are
+ * discarded when the next icon is requested or when @c clear() is
+ * called.  Icons that have already been set on a widget are not
+ * changed.  The cache is only intended to be used from the GUI thread.
+ *
+ * @author Jonathan Marten
+ **/
+
+namespace IconCache
+{
+    /**
+     * Get a theme icon, rendered to suit a widget.
+     *
+     * The size is the style's button icon size for the widget, and the
+     * device pixel ratio is that of the widget.
+     *
+     * @param iconName The icon name
+     * @param widget The widget that the icon is to be shown on
+     * @return The icon, or a null icon if it is not found in the theme
+     **/
+    QIcon icon(const QString &iconName, const QWidget *widget);
+
+    /**
+     * Get a theme icon, rendered at a specified size.
+     *
+     * @param iconName The icon name
+     * @param size The icon size, in device independent pixels
+     * @param dpr The device pixel ratio that it is rendered for
+     * @return The icon, or a null icon if it is not found in the theme
+     **/
+    QIcon icon(const QString &iconName, int size, qreal dpr);
+
+    /**
+     * Discard all of the cached icons.
+     **/
+    void clear();
+
+    /**
+     * Set the memory budget for the cache.  The default is 2Mb.
+     *
+     * @param bytes The maximum size of the cached icons
+     **/
+    void setCacheLimit(int bytes);
+}
+
+#endif							// ICONCACHE_H
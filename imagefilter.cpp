@@ -22,60 +22,42 @@
 
 #include "imagefilter.h"
 
-#include <qimagereader.h>
-#include <qimagewriter.h>
-#include <qmimedatabase.h>
-#include <qmimetype.h>
-
 #include <klocalizedstring.h>
 
-
-static bool commentLessThan(const QString &s1, const QString &s2)
-{
-    const int idx1 = s1.indexOf('|');
-    const int idx2 = s2.indexOf('|');
-    return (s1.mid(idx1+1).toLower()<s2.mid(idx2+1).toLower());
-}
+#include "imageformattable.h"
+#include "operationwatchdog.h"
 
 
 static QStringList filterList(ImageFilter::FilterMode mode, ImageFilter::FilterOptions options, bool kdeFormat)
 {
-    QStringList list;
-    QStringList allPatterns;
+    OperationWatchdog::Scope scope("ImageFilter::filterList");
 
-    QList<QByteArray> mimeTypes;
-    if (mode==ImageFilter::Writing) mimeTypes = QImageWriter::supportedMimeTypes();
-    else mimeTypes = QImageReader::supportedMimeTypes();
+    // Unless the list is wanted unsorted, sort by the MIME type comment
+    const ImageFormatTable::Capability cap = (mode==ImageFilter::Writing ? ImageFormatTable::CanWrite : ImageFormatTable::CanRead);
+    const ImageFormatTable::Source source = ((mode==ImageFilter::Reading && (options & ImageFilter::NoPluginLoad))
+                                             ? ImageFormatTable::PluginMetadata : ImageFormatTable::LoadPlugins);
+    const QVector<const ImageFormatTable::Format *> formats = ImageFormatTable::instance(source)->formatsFor(cap, !(options & ImageFilter::Unsorted));
 
-    QMimeDatabase db;
-
-    foreach (const QByteArray &mimeType, mimeTypes)
+    // Options which are required for writing
+    ImageFormatTable::WriteOptions needOptions;
+    if (mode==ImageFilter::Writing)
     {
-        QMimeType mime = db.mimeTypeForName(mimeType);
-        if (!mime.isValid()) continue;
-
-        QStringList pats = mime.globPatterns();
-        list.append(pats.join(' ')+'|'+mime.comment());
-        if (options & ImageFilter::AllImages) allPatterns.append(pats);
+        if (options & ImageFilter::NeedQuality) needOptions |= ImageFormatTable::SupportsQuality;
+        if (options & ImageFilter::NeedTransparency) needOptions |= ImageFormatTable::SupportsTransparency;
+        if (options & ImageFilter::NeedLossless) needOptions |= ImageFormatTable::Lossless;
     }
 
-    if (!(options & ImageFilter::Unsorted))		// unless list wanted unsorted,
-    {							// sort by the mime type comment
-        std::sort(list.begin(), list.end(), commentLessThan);
-    }
+    QStringList list;
+    QStringList allPatterns;
 
-    if (!kdeFormat)
+    for (const ImageFormatTable::Format *fmt : formats)
     {
-        // We generated a KDE format filter above (for ease of sorting),
-        // so if we want a Qt format filter then it needs to be rearranged.
-        for (QStringList::iterator it = list.begin(); it!=list.end(); ++it)
-        {
-            QString &filter = (*it);			// modifying list in place
-            int idx = filter.indexOf('|');
-            if (idx==-1) continue;
-            filter = filter.mid(idx+1)+" ("+filter.left(idx)+')';
-            (*it) = filter;
-        }
+        if ((fmt->writeOptions & needOptions)!=needOptions) continue;
+
+        const QString pats = fmt->globPatterns.join(' ');
+        if (kdeFormat) list.append(pats+'|'+fmt->comment);
+        else list.append(fmt->comment+" ("+pats+')');
+        if (options & ImageFilter::AllImages) allPatterns.append(fmt->globPatterns);
     }
 
     if (!allPatterns.isEmpty())				// want an "All Images" entry
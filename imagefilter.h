@@ -25,7 +25,7 @@
 
 #include <qstringlist.h>
 
-#include "libkfdialog_export.h"
+#include "libkfdialogcore_export.h"
 
 
 /**
@@ -36,6 +36,23 @@
  * in Frameworks, a KDE filter is still required for a @c KUrlRequester
  * or if KFileWidget is used directly.
  *
+ * All of the functions are thread safe and may be called from any
+ * thread.  The filters are generated from the shared ImageFormatTable,
+ * which is built the first time that a filter is requested.  If the
+ * format corresponding to a filter or file name is required, look
+ * it up in that table instead of parsing the filter strings.
+ *
+ * Generating a filter normally loads all of the installed image format
+ * plugins.  For a reading filter, the @c NoPluginLoad option generates
+ * it from the plugins' metadata instead; see @c ImageFormatTable::instance()
+ * for details.  This option has no effect for a writing filter.
+ *
+ * For a writing filter, the @c NeedQuality, @c NeedTransparency and
+ * @c NeedLossless options restrict the filter to formats which support
+ * those options when saving; see @c ImageFormatTable::WriteOption.
+ * They have no effect for a reading filter.
+ *
+ * @see ImageFormatTable
  * @author Jonathan Marten
  **/
 
@@ -58,7 +75,11 @@ namespace ImageFilter
         NoOptions = 0x00,				///< No options specified
         AllImages = 0x10,				///< Include an "All images" entry
         AllFiles  = 0x20,				///< Include an "All files" entry
-        Unsorted  = 0x40				///< Do not sort the returned list
+        Unsorted  = 0x40,				///< Do not sort the returned list
+        NoPluginLoad = 0x80,				///< Avoid loading image plugins, for reading
+        NeedQuality = 0x100,				///< Only formats which support setting quality
+        NeedTransparency = 0x200,			///< Only formats which can save transparency
+        NeedLossless = 0x400				///< Only lossless formats
     };
     Q_DECLARE_FLAGS(FilterOptions, FilterOption)
 
@@ -72,8 +93,8 @@ namespace ImageFilter
      * @param options Options for the filter generation.
      * @return The filter list
      **/
-    LIBKFDIALOG_EXPORT QStringList qtFilterList(ImageFilter::FilterMode mode,
-                                                  ImageFilter::FilterOptions options = ImageFilter::NoOptions);
+    LIBKFDIALOGCORE_EXPORT QStringList qtFilterList(ImageFilter::FilterMode mode,
+                                                      ImageFilter::FilterOptions options = ImageFilter::NoOptions);
 
     /**
      * Generate a Qt-style filter string.
@@ -85,8 +106,8 @@ namespace ImageFilter
      * @param options Options for the filter generation.
      * @return The filter string
      **/
-    LIBKFDIALOG_EXPORT QString qtFilterString(ImageFilter::FilterMode mode,
-                                                ImageFilter::FilterOptions options = ImageFilter::NoOptions);
+    LIBKFDIALOGCORE_EXPORT QString qtFilterString(ImageFilter::FilterMode mode,
+                                                    ImageFilter::FilterOptions options = ImageFilter::NoOptions);
 
     /**
      * Generate a KDE-style filter list.
@@ -97,8 +118,8 @@ namespace ImageFilter
      * @param options Options for the filter generation.
      * @return The filter string
      **/
-    LIBKFDIALOG_EXPORT QString kdeFilter(ImageFilter::FilterMode mode,
-                                           ImageFilter::FilterOptions options = ImageFilter::NoOptions);
+    LIBKFDIALOGCORE_EXPORT QString kdeFilter(ImageFilter::FilterMode mode,
+                                               ImageFilter::FilterOptions options = ImageFilter::NoOptions);
 }
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(ImageFilter::FilterOptions)
@@ -0,0 +1,350 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include "imageformattable.h"
+
+#include <qimagereader.h>
+#include <qimagewriter.h>
+#include <qmimedatabase.h>
+#include <qmimetype.h>
+#include <qatomic.h>
+#include <qcoreapplication.h>
+#include <qdiriterator.h>
+#include <qlibrary.h>
+#include <qpluginloader.h>
+#include <qjsonobject.h>
+#include <qjsonarray.h>
+#include <qimageiohandler.h>
+
+#include "operationwatchdog.h"
+#include "libkfdialog_logging.h"
+
+
+// The tables are built only once per process, and are then immutable so
+// that, once published, they can be read by any thread without locking.
+// If two threads both find that there is no table yet, they will both
+// build one but only the first to be published is used.
+static QAtomicPointer<const ImageFormatTable> sInstance;
+static QAtomicPointer<const ImageFormatTable> sMetadataInstance;
+
+// The image formats which are built into QtGui, and so do not
+// appear in any plugin metadata.  All of them can be read and written.
+static const char *sBuiltinMimeTypes[] =
+{
+    "image/bmp",
+    "image/png",
+    "image/x-portable-bitmap",
+    "image/x-portable-graymap",
+    "image/x-portable-pixmap",
+    "image/x-xbitmap",
+    "image/x-xpixmap",
+    nullptr
+};
+
+
+const ImageFormatTable *ImageFormatTable::instance(ImageFormatTable::Source source)
+{
+    QAtomicPointer<const ImageFormatTable> &ptr = (source==ImageFormatTable::PluginMetadata ? sMetadataInstance : sInstance);
+    const ImageFormatTable *table = ptr.loadAcquire();
+    if (table!=nullptr) return (table);			// already available
+
+    OperationWatchdog::Scope scope("ImageFormatTable::build");
+    const ImageFormatTable *newTable = (source==ImageFormatTable::PluginMetadata ? buildFromMetadata() : build());
+    if (newTable==nullptr)				// metadata was not usable,
+    {							// so share the full table
+        table = instance(ImageFormatTable::LoadPlugins);
+        ptr.testAndSetOrdered(nullptr, table);
+        return (ptr.loadAcquire());
+    }
+
+    if (ptr.testAndSetOrdered(nullptr, newTable)) return (newTable);
+
+    delete newTable;					// another thread was first
+    return (ptr.loadAcquire());
+}
+
+
+void ImageFormatTable::addFormats(const QList<QByteArray> &mimeTypes, ImageFormatTable::Capabilities caps)
+{
+    QMimeDatabase db;					// thread safe, see its API doc
+
+    for (const QByteArray &mimeType : mimeTypes)
+    {
+        const QMimeType mime = db.mimeTypeForName(mimeType);
+        if (!mime.isValid()) continue;
+
+        const QHash<QString, int>::const_iterator it = mMimeIndex.constFind(mime.name());
+        if (it!=mMimeIndex.constEnd())			// already seen this type
+        {
+            mFormats[it.value()].capabilities |= caps;
+            continue;
+        }
+
+        const int idx = mFormats.count();
+        mFormats.append(Format { mime.name(), mime.globPatterns(), mime.preferredSuffix(), mime.comment(),
+                                 caps, ImageFormatTable::NoWriteOptions });
+
+        mMimeIndex.insert(mime.name(), idx);
+        for (const QString &alias : mime.aliases()) mMimeIndex.insert(alias, idx);
+
+        // The suffixes are those of the glob patterns which are
+        // of the form "*.ext", including multiple-dot ones such as
+        // "*.ext.gz".  A suffix may be shared by more than one format.
+        for (const QString &suffix : mime.suffixes()) mSuffixIndex[suffix.toLower()].append(idx);
+    }
+}
+
+
+void ImageFormatTable::sortFormats()
+{
+    mSorted.reserve(mFormats.count());
+    for (int i = 0; i<mFormats.count(); ++i) mSorted.append(i);
+
+    const QVector<Format> &formats = mFormats;
+    std::sort(mSorted.begin(), mSorted.end(), [&formats](int i1, int i2)
+    {
+        return (formats[i1].comment.compare(formats[i2].comment, Qt::CaseInsensitive)<0);
+    });
+}
+
+
+// Formats which lose detail when they are written, at least with
+// the default settings.  All other formats are assumed to be lossless.
+static const char *sLossyMimeTypes[] =
+{
+    "image/jpeg",
+    "image/jp2",
+    "image/webp",
+    "image/heif",
+    "image/avif",
+    "image/jxl",
+    nullptr
+};
+
+// Formats which can save an alpha channel, or at least
+// a transparent colour.
+static const char *sTransparentMimeTypes[] =
+{
+    "image/png",
+    "image/gif",
+    "image/tiff",
+    "image/webp",
+    "image/jp2",
+    "image/heif",
+    "image/avif",
+    "image/jxl",
+    "image/x-tga",
+    "image/x-xpixmap",
+    "image/x-exr",
+    "image/x-icns",
+    "image/vnd.microsoft.icon",
+    "image/openraster",
+    nullptr
+};
+
+
+static bool inList(const QString &mimeName, const char **list)
+{
+    for (const char **p = list; *p!=nullptr; ++p)
+    {
+        if (mimeName==QLatin1String(*p)) return (true);
+    }
+    return (false);
+}
+
+
+// The write options of the formats built into QtGui, as reported by
+// their handlers.  These are used for the metadata table, because
+// asking QImageWriter would load all of the plugins.
+struct BuiltinWriteOptions
+{
+    const char *mimeType;
+    int options;
+};
+
+static const BuiltinWriteOptions sBuiltinWriteOptions[] =
+{
+    { "image/png", ImageFormatTable::SupportsQuality|ImageFormatTable::SupportsDescription },
+    { nullptr, ImageFormatTable::NoWriteOptions }
+};
+
+
+void ImageFormatTable::findWriteOptions(bool queryWriters)
+{
+    for (Format &fmt : mFormats)
+    {
+        if (!(fmt.capabilities & ImageFormatTable::CanWrite)) continue;
+
+        if (queryWriters)
+        {
+            const QList<QByteArray> names = QImageWriter::imageFormatsForMimeType(fmt.mimeName.toLatin1());
+            if (!names.isEmpty())
+            {
+                QImageWriter writer;
+                writer.setFormat(names.first());
+                if (writer.supportsOption(QImageIOHandler::Quality)) fmt.writeOptions |= ImageFormatTable::SupportsQuality;
+                if (writer.supportsOption(QImageIOHandler::CompressionRatio)) fmt.writeOptions |= ImageFormatTable::SupportsCompression;
+                if (writer.supportsOption(QImageIOHandler::Description)) fmt.writeOptions |= ImageFormatTable::SupportsDescription;
+                if (writer.supportsOption(QImageIOHandler::Animation)) fmt.writeOptions |= ImageFormatTable::SupportsAnimation;
+            }
+        }
+        else
+        {
+            for (const BuiltinWriteOptions *p = sBuiltinWriteOptions; p->mimeType!=nullptr; ++p)
+            {
+                if (fmt.mimeName==QLatin1String(p->mimeType)) fmt.writeOptions |= ImageFormatTable::WriteOptions(p->options);
+            }
+        }
+
+        if (inList(fmt.mimeName, sTransparentMimeTypes)) fmt.writeOptions |= ImageFormatTable::SupportsTransparency;
+        if (!inList(fmt.mimeName, sLossyMimeTypes)) fmt.writeOptions |= ImageFormatTable::Lossless;
+    }
+}
+
+
+const ImageFormatTable *ImageFormatTable::build()
+{
+    ImageFormatTable *table = new ImageFormatTable;
+    table->addFormats(QImageReader::supportedMimeTypes(), ImageFormatTable::CanRead);
+    table->addFormats(QImageWriter::supportedMimeTypes(), ImageFormatTable::CanWrite);
+    table->findWriteOptions(true);
+    table->sortFormats();
+
+    qCDebug(LIBKFDIALOG_LOG) << "found" << table->mFormats.count() << "formats";
+    return (table);
+}
+
+
+static bool metadataMimeTypes(const QJsonObject &json, QList<QByteArray> *mimeTypes)
+{
+    if (json.value(QLatin1String("IID")).toString()!=QLatin1String(QImageIOHandlerFactoryInterface_iid)) return (true);
+
+    // Not all plugins, especially older ones, list their MIME types
+    // in their metadata.  If one does not, the metadata is incomplete.
+    const QJsonObject metaData = json.value(QLatin1String("MetaData")).toObject();
+    const QJsonArray types = metaData.value(QLatin1String("MimeTypes")).toArray();
+    const QJsonArray keys = metaData.value(QLatin1String("Keys")).toArray();
+    if (types.isEmpty() && !keys.isEmpty()) return (false);
+
+    for (const QJsonValue &type : types) mimeTypes->append(type.toString().toLatin1());
+    return (true);
+}
+
+
+const ImageFormatTable *ImageFormatTable::buildFromMetadata()
+{
+    QList<QByteArray> mimeTypes;
+
+    // Reading the metadata only reads the plugin file, it does not
+    // load the plugin library or run any of its code.
+    const QStringList paths = QCoreApplication::libraryPaths();
+    for (const QString &path : paths)
+    {
+        QDirIterator it(path+"/imageformats", QDir::Files);
+        while (it.hasNext())
+        {
+            const QString file = it.next();
+            if (!QLibrary::isLibrary(file)) continue;
+
+            const QJsonObject json = QPluginLoader(file).metaData();
+            if (json.isEmpty()) continue;		// not a valid plugin
+            if (!metadataMimeTypes(json, &mimeTypes))
+            {
+                qCDebug(LIBKFDIALOG_LOG) << "no MIME types in metadata for" << file;
+                return (nullptr);
+            }
+        }
+    }
+
+    const QVector<QStaticPlugin> statics = QPluginLoader::staticPlugins();
+    for (const QStaticPlugin &plugin : statics)
+    {
+        if (!metadataMimeTypes(plugin.metaData(), &mimeTypes)) return (nullptr);
+    }
+
+    QList<QByteArray> builtins;
+    for (const char **p = sBuiltinMimeTypes; *p!=nullptr; ++p) builtins.append(QByteArray(*p));
+
+    ImageFormatTable *table = new ImageFormatTable;
+    table->addFormats(builtins, ImageFormatTable::CanRead|ImageFormatTable::CanWrite);
+    table->addFormats(mimeTypes, ImageFormatTable::CanRead);
+    table->findWriteOptions(false);			// only the built in formats
+    table->sortFormats();
+
+    qCDebug(LIBKFDIALOG_LOG) << "found" << table->mFormats.count() << "formats from metadata";
+    return (table);
+}
+
+
+QVector<const ImageFormatTable::Format *> ImageFormatTable::formatsFor(ImageFormatTable::Capability cap, bool sorted) const
+{
+    QVector<const Format *> result;
+    result.reserve(mFormats.count());
+    for (int i = 0; i<mFormats.count(); ++i)
+    {
+        const Format &fmt = mFormats[sorted ? mSorted[i] : i];
+        if (fmt.capabilities & cap) result.append(&fmt);
+    }
+    return (result);
+}
+
+
+const ImageFormatTable::Format *ImageFormatTable::formatForSuffix(const QString &suffix) const
+{
+    const SuffixIndex::const_iterator it = mSuffixIndex.constFind(suffix.toLower());
+    if (it==mSuffixIndex.constEnd()) return (nullptr);
+    return (&mFormats[it.value().first()]);
+}
+
+
+const ImageFormatTable::Format *ImageFormatTable::formatForFileName(const QString &fileName, ImageFormatTable::Capability cap) const
+{
+    const QString name = fileName.mid(fileName.lastIndexOf('/')+1).toLower();
+
+    // Try each possible suffix of the file name, longest first, so that
+    // a multiple-dot suffix takes precedence over its final part.  The
+    // number of lookups is limited by the number of dots in the name.
+    int dot = name.indexOf('.');
+    while (dot!=-1)
+    {
+        const SuffixIndex::const_iterator it = mSuffixIndex.constFind(name.mid(dot+1));
+        if (it!=mSuffixIndex.constEnd())
+        {
+            for (const int idx : it.value())
+            {
+                if (mFormats[idx].capabilities & cap) return (&mFormats[idx]);
+            }
+        }
+
+        dot = name.indexOf('.', dot+1);
+    }
+
+    return (nullptr);					// no matching format
+}
+
+
+const ImageFormatTable::Format *ImageFormatTable::formatForMimeName(const QString &mimeName) const
+{
+    const QHash<QString, int>::const_iterator it = mMimeIndex.constFind(mimeName);
+    if (it==mMimeIndex.constEnd()) return (nullptr);
+    return (&mFormats[it.value()]);
+}
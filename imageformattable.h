@@ -0,0 +1,214 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#ifndef IMAGEFORMATTABLE_H
+#define IMAGEFORMATTABLE_H
+
+#include <qstringlist.h>
+#include <qvector.h>
+#include <qhash.h>
+
+#include "libkfdialogcore_export.h"
+
+
+/**
+ * @short A table of the image formats supported for reading or writing.
+ *
+ * This provides the same information that is used to generate the
+ * filters from @c ImageFilter, but in a structured form so that a
+ * filter or file name selected by the user can be mapped back to
+ * an image format without having to parse the filter strings.
+ *
+ * There is only one table, which is built the first time that it is
+ * used and is then shared for the lifetime of the process.  As well as
+ * the basic information, the table also records which options are
+ * supported for writing each format, so that there is no need to
+ * create a QImageWriter to find out.  Once built
+ * the table cannot change, and it may be used by any thread.
+ *
+ * @code
+ * const ImageFormatTable::Format *fmt = ImageFormatTable::instance()->formatForSuffix("png");
+ * if (fmt!=nullptr && (fmt->capabilities & ImageFormatTable::CanWrite)) ...
+ * @endcode
+ *
+ * @see ImageFilter
+ * @author Jonathan Marten
+ **/
+
+class LIBKFDIALOGCORE_EXPORT ImageFormatTable
+{
+public:
+    /**
+     * Enumeration specifying the capabilities of an image format.
+     **/
+    enum Capability
+    {
+        CanRead = 0x01,					///< Supported by QImageReader
+        CanWrite = 0x02					///< Supported by QImageWriter
+    };
+    Q_DECLARE_FLAGS(Capabilities, Capability)
+
+    /**
+     * Enumeration specifying the options supported when writing an image.
+     *
+     * @c SupportsQuality, @c SupportsCompression, @c SupportsDescription
+     * and @c SupportsAnimation are as reported by QImageWriter for the format.
+     * @c SupportsTransparency and @c Lossless are from a list of well
+     * known formats, because there is no way to query them.
+     **/
+    enum WriteOption
+    {
+        NoWriteOptions = 0x00,				///< No options supported
+        SupportsQuality = 0x01,				///< Quality can be set
+        SupportsCompression = 0x02,			///< Compression ratio can be set
+        SupportsDescription = 0x04,			///< Text description can be saved
+        SupportsAnimation = 0x08,			///< Format can hold multiple images
+        SupportsTransparency = 0x10,			///< Alpha channel can be saved
+        Lossless = 0x20					///< Compression does not lose detail
+    };
+    Q_DECLARE_FLAGS(WriteOptions, WriteOption)
+
+    /**
+     * Enumeration specifying how the supported formats are found.
+     **/
+    enum Source
+    {
+        LoadPlugins = 0,				///< Load and query all image plugins
+        PluginMetadata = 1				///< Use only the plugin metadata
+    };
+
+    /**
+     * Information about an image format.
+     **/
+    struct Format
+    {
+        QString mimeName;				///< MIME type name
+        QStringList globPatterns;			///< File name patterns
+        QString preferredSuffix;			///< Preferred file name suffix
+        QString comment;				///< Description of the format
+        ImageFormatTable::Capabilities capabilities;	///< Reading and writing capabilities
+        ImageFormatTable::WriteOptions writeOptions;	///< Options supported for writing
+    };
+
+    /**
+     * Access the shared format table.
+     *
+     * The table is built the first time that this is called.
+     *
+     * Normally the supported formats are found by asking QImageReader
+     * and QImageWriter, which means that every image format plugin is
+     * loaded.  That can take a significant time and memory if there are
+     * many plugins installed, some of which may use large libraries.
+     *
+     * If @p source is @c PluginMetadata, then instead the formats are
+     * found from the metadata embedded in each plugin, which can be read
+     * without loading the plugin.  However, the metadata does not say
+     * whether the plugin can write images, so the formats from plugins
+     * are only marked as @c CanRead and this table should only be used
+     * for finding formats to read.  The write options of the formats
+     * built into Qt are also known without loading any plugins.  If any plugin does not list its
+     * MIME types in its metadata, then the normal table is returned.
+     *
+     * @param source How the supported formats are to be found
+     * @return the format table
+     **/
+    static const ImageFormatTable *instance(ImageFormatTable::Source source = ImageFormatTable::LoadPlugins);
+
+    /**
+     * Get all of the formats in the table.
+     *
+     * @return the formats, in the order that they were enumerated
+     **/
+    const QVector<ImageFormatTable::Format> &formats() const	{ return (mFormats); }
+
+    /**
+     * Get the formats with a particular capability.
+     *
+     * @param cap The capability required
+     * @param sorted If this is @c true, the formats are sorted by
+     * their comment; otherwise they are in the order that they were
+     * enumerated.
+     * @return the formats
+     **/
+    QVector<const ImageFormatTable::Format *> formatsFor(ImageFormatTable::Capability cap, bool sorted = true) const;
+
+    /**
+     * Look up the format for a file name suffix.
+     *
+     * @param suffix The suffix, without any leading dot.  Case
+     * is not significant.
+     * @return the format, or @c nullptr if no format uses that suffix
+     **/
+    const ImageFormatTable::Format *formatForSuffix(const QString &suffix) const;
+
+    /**
+     * Look up the format for a file name.
+     *
+     * This is intended to be fast enough to be used as the user is
+     * typing a file name, for example to update a format selector
+     * in a save dialogue.  It matches the file name against all of
+     * the suffix patterns (those of the form @c "*.ext") of the
+     * supported formats, including those with more than one dot
+     * such as @c "*.ext.gz", with the longest matching suffix taking
+     * precedence.  No file system access is done, and the MIME database
+     * is not used.
+     *
+     * @param fileName The file name or path.  Case is not significant.
+     * @param cap The capability that the format must have.
+     * @return the format, or @c nullptr if the file name does not match
+     * any format with the required capability.
+     **/
+    const ImageFormatTable::Format *formatForFileName(const QString &fileName,
+                                                      ImageFormatTable::Capability cap = ImageFormatTable::CanWrite) const;
+
+    /**
+     * Look up the format for a MIME type.
+     *
+     * @param mimeName The MIME type name, or an alias for it
+     * @return the format, or @c nullptr if the MIME type is not
+     * a supported image format
+     **/
+    const ImageFormatTable::Format *formatForMimeName(const QString &mimeName) const;
+
+private:
+    ImageFormatTable() = default;
+    Q_DISABLE_COPY(ImageFormatTable)
+
+    static const ImageFormatTable *build();
+    static const ImageFormatTable *buildFromMetadata();
+    void addFormats(const QList<QByteArray> &mimeTypes, ImageFormatTable::Capabilities caps);
+    void sortFormats();
+    void findWriteOptions(bool queryWriters);
+
+private:
+    typedef QHash<QString, QVector<int> > SuffixIndex;
+
+    QVector<ImageFormatTable::Format> mFormats;
+    QVector<int> mSorted;
+    SuffixIndex mSuffixIndex;
+    QHash<QString, int> mMimeIndex;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(ImageFormatTable::Capabilities)
+Q_DECLARE_OPERATORS_FOR_FLAGS(ImageFormatTable::WriteOptions)
+
+#endif							// IMAGEFORMATTABLE_H
@@ -0,0 +1,279 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include "imagepreviewprovider.h"
+
+#include <qthreadpool.h>
+#include <qrunnable.h>
+#include <qmutex.h>
+#include <qatomic.h>
+#include <qimagereader.h>
+#include <qset.h>
+
+#include "imageformattable.h"
+#include "libkfdialog_logging.h"
+
+
+// State shared between the provider and its worker jobs, which may
+// still be queued or running after the provider has been deleted.
+// Results are only posted back while the provider still exists.
+struct ImagePreviewShared
+{
+    QMutex mutex;					// protects provider below
+    ImagePreviewProvider *provider;			// null when provider deleted
+};
+
+
+// A job is not deleted by the thread pool, but is owned by shared pointers
+// held by the provider while the preview is pending and by the job itself
+// while it is queued or running.  That means that the provider can safely
+// use the job's address to take it back from the thread pool's queue,
+// because that address cannot be reused for another job while the
+// provider still refers to it.
+class ImagePreviewJob : public QRunnable
+{
+public:
+    ImagePreviewJob(const QSharedPointer<ImagePreviewShared> &shared,
+                    const QString &file, const QSize &size)
+        : mStale(false),
+          mShared(shared),
+          mCancelled(0),
+          mFile(file),
+          mSize(size)						{ setAutoDelete(false); }
+
+    void run() override;
+
+    void setCancelled(bool on)				{ mCancelled.storeRelease(on ? 1 : 0); }
+    bool isCancelled() const				{ return (mCancelled.loadAcquire()!=0); }
+
+    // These are only used by the provider, in the GUI thread
+    QSharedPointer<ImagePreviewJob> mSelf;		// reference while queued
+    bool mStale;					// file changed while running
+
+private:
+    QImage readPreview() const;
+
+private:
+    QSharedPointer<ImagePreviewShared> mShared;
+    QAtomicInt mCancelled;
+    QString mFile;
+    QSize mSize;
+};
+
+
+void ImagePreviewJob::run()
+{
+    // Take over the job's own reference.  This is destroyed last,
+    // when nothing else in the job will be used, and if the provider
+    // has no reference to it any more then that deletes the job.
+    QSharedPointer<ImagePreviewJob> self;
+    self.swap(mSelf);
+
+    const bool skipped = isCancelled();			// no longer wanted
+    QImage image;
+    if (!skipped) image = readPreview();
+
+    QMutexLocker locker(&mShared->mutex);
+    ImagePreviewProvider *provider = mShared->provider;
+    if (provider==nullptr) return;			// provider has gone away
+
+    const QString file = mFile;
+    const QSize size = mSize;
+    QMetaObject::invokeMethod(provider, [provider, file, image, size, skipped]() { provider->previewDone(file, image, size, skipped); }, Qt::QueuedConnection);
+}
+
+
+QImage ImagePreviewJob::readPreview() const
+{
+    QImageReader reader(mFile);
+    reader.setAutoTransform(true);
+
+    // Have the image decoded directly at the preview size if
+    // possible, which for some formats (e.g. JPEG) is much faster
+    // than decoding at full size and then scaling.
+    const QSize imageSize = reader.size();
+    if (imageSize.isValid() && (imageSize.width()>mSize.width() || imageSize.height()>mSize.height()))
+    {
+        reader.setScaledSize(imageSize.scaled(mSize, Qt::KeepAspectRatio));
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) qCDebug(LIBKFDIALOG_LOG) << "cannot read" << mFile << reader.errorString();
+    else if (image.width()>mSize.width() || image.height()>mSize.height())
+    {							// scaling not supported by reader
+        image = image.scaled(mSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    return (image);
+}
+
+
+ImagePreviewProvider::ImagePreviewProvider(QObject *pnt)
+    : QObject(pnt)
+{
+    mPreviewSize = QSize(128, 128);
+    mThreadPool = QThreadPool::globalInstance();
+    mCache.setMaxCost(32*1024*1024);
+
+    mShared.reset(new ImagePreviewShared);
+    mShared->provider = this;
+}
+
+
+ImagePreviewProvider::~ImagePreviewProvider()
+{
+    for (QHash<QString, QSharedPointer<ImagePreviewJob> >::const_iterator it = mPending.constBegin(); it!=mPending.constEnd(); ++it)
+    {
+        if (!takeJob(it.value())) it.value()->setCancelled(true);
+    }
+
+    QMutexLocker locker(&mShared->mutex);
+    mShared->provider = nullptr;			// no more results wanted
+}
+
+
+void ImagePreviewProvider::setPreviewSize(const QSize &size)
+{
+    if (size==mPreviewSize) return;
+    mPreviewSize = size;
+    mCache.clear();
+}
+
+
+void ImagePreviewProvider::setCacheLimit(int bytes)
+{
+    mCache.setMaxCost(bytes);
+}
+
+
+void ImagePreviewProvider::setThreadPool(QThreadPool *pool)
+{
+    mThreadPool = pool;
+}
+
+
+bool ImagePreviewProvider::takeJob(const QSharedPointer<ImagePreviewJob> &job)
+{
+    // The job can only be taken if it has not started yet, in which
+    // case it will never run and so will not need its own reference.
+    if (!mThreadPool->tryTake(job.data())) return (false);
+    job->mSelf.clear();
+    return (true);
+}
+
+
+QImage ImagePreviewProvider::preview(const QString &file)
+{
+    const QImage *cached = mCache.object(file);		// also marks as recently used
+    if (cached!=nullptr) return (*cached);
+
+    QHash<QString, QSharedPointer<ImagePreviewJob> >::iterator it = mPending.find(file);
+    if (it!=mPending.end())				// already waiting for it
+    {
+        it.value()->setCancelled(false);		// wanted again if cancelled
+        return (QImage());
+    }
+
+    // Only attempt to read files of a format that can be read
+    if (ImageFormatTable::instance()->formatForFileName(file, ImageFormatTable::CanRead)==nullptr) return (QImage());
+
+    QSharedPointer<ImagePreviewJob> job(new ImagePreviewJob(mShared, file, mPreviewSize));
+    job->mSelf = job;
+    mPending.insert(file, job);
+    mThreadPool->start(job.data());
+    return (QImage());
+}
+
+
+void ImagePreviewProvider::cancel(const QString &file)
+{
+    QHash<QString, QSharedPointer<ImagePreviewJob> >::iterator it = mPending.find(file);
+    if (it==mPending.end()) return;			// not pending
+
+    // If the job has not started then it is removed from the queue,
+    // otherwise it is left to finish but no signal is emitted.
+    if (takeJob(it.value())) mPending.erase(it);
+    else it.value()->setCancelled(true);
+}
+
+
+void ImagePreviewProvider::setVisibleFiles(const QStringList &files)
+{
+    const QSet<QString> visible(files.constBegin(), files.constEnd());
+    for (QHash<QString, QSharedPointer<ImagePreviewJob> >::iterator it = mPending.begin(); it!=mPending.end(); )
+    {
+        const bool wanted = visible.contains(it.key());
+        if (!wanted && takeJob(it.value()))
+        {
+            it = mPending.erase(it);
+            continue;
+        }
+
+        it.value()->setCancelled(!wanted);
+        ++it;
+    }
+}
+
+
+void ImagePreviewProvider::invalidate(const QString &file)
+{
+    mCache.remove(file);
+
+    QHash<QString, QSharedPointer<ImagePreviewJob> >::iterator it = mPending.find(file);
+    if (it==mPending.end()) return;			// not pending
+
+    // A job that has not started is removed, so that a new one will be
+    // started the next time that the preview is requested.  One that is
+    // already running may have read the old file, so its result is not
+    // used.  If the preview is still wanted it is then generated again.
+    if (takeJob(it.value())) mPending.erase(it);
+    else it.value()->mStale = true;
+}
+
+
+void ImagePreviewProvider::previewDone(const QString &file, const QImage &image, const QSize &size, bool skipped)
+{
+    const QSharedPointer<ImagePreviewJob> job = mPending.take(file);
+    if (job.isNull()) return;				// not expecting this
+    const bool cancelled = job->isCancelled();
+
+    // If it was cancelled before it started, but wanted again since,
+    // or the file changed while it was running, then start again.
+    if (skipped || job->mStale)
+    {
+        if (!cancelled) preview(file);
+        return;
+    }
+
+    // The preview may have been generated for a different size if that
+    // was changed in the meantime.  The job is tagged with the size that
+    // it was started for, because the image itself may be smaller than
+    // either size.  If it is still wanted then it is generated again.
+    if (size!=mPreviewSize)
+    {
+        if (!cancelled) preview(file);
+        return;
+    }
+
+    if (!image.isNull()) mCache.insert(file, new QImage(image), int(image.sizeInBytes()));
+    if (!cancelled) emit previewReady(file, image);
+}
@@ -0,0 +1,185 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#ifndef IMAGEPREVIEWPROVIDER_H
+#define IMAGEPREVIEWPROVIDER_H
+
+#include <qobject.h>
+#include <qstringlist.h>
+#include <qsharedpointer.h>
+#include <qcache.h>
+#include <qhash.h>
+#include <qimage.h>
+
+#include "libkfdialogcore_export.h"
+
+class QThreadPool;
+class ImagePreviewJob;
+struct ImagePreviewShared;
+
+
+/**
+ * @short Generate preview images for image files in the background.
+ *
+ * This is intended for use in a file dialogue or a file list showing
+ * image files, where there may be a large number of files to show
+ * previews for.  The previews are decoded at a reduced size, directly
+ * from the file where the image format supports it, in parallel using
+ * a thread pool.  Decoded previews are kept in a memory cache with
+ * a limited size, the least recently used being discarded first.
+ *
+ * Only files which have a suffix of an image format that can be read,
+ * as listed in the ImageFormatTable, are previewed.
+ *
+ * @code
+ * ImagePreviewProvider *previews = new ImagePreviewProvider(this);
+ * connect(previews, &ImagePreviewProvider::previewReady, this, &MyView::slotPreviewReady);
+ * ...
+ * QImage img = previews->preview(file);	// may be null, will be signalled later
+ * @endcode
+ *
+ * @see ImageFormatTable
+ * @author Jonathan Marten
+ **/
+
+class LIBKFDIALOGCORE_EXPORT ImagePreviewProvider : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param pnt Parent object
+     **/
+    explicit ImagePreviewProvider(QObject *pnt = nullptr);
+
+    /**
+     * Destructor.
+     *
+     * Any previews still waiting to be generated are cancelled.
+     **/
+    ~ImagePreviewProvider() override;
+
+    /**
+     * Set the maximum size of the preview images.
+     *
+     * Images are scaled down to fit within this size, preserving their
+     * aspect ratio, but are never scaled up.  The default is 128x128.
+     * Changing the size clears the cache.
+     *
+     * @param size The maximum size
+     **/
+    void setPreviewSize(const QSize &size);
+
+    /**
+     * Set the memory budget for the preview cache.
+     *
+     * The default is 32Mb.
+     *
+     * @param bytes The maximum size of the cached images
+     **/
+    void setCacheLimit(int bytes);
+
+    /**
+     * Set the thread pool to be used.
+     *
+     * If this is not set then the global thread pool is used.
+     *
+     * @param pool The thread pool
+     **/
+    void setThreadPool(QThreadPool *pool);
+
+    /**
+     * Get the preview for a file.
+     *
+     * If the preview is in the cache then it is returned immediately.
+     * Otherwise a null image is returned, and the preview is generated
+     * in the background and the @c previewReady() signal is emitted
+     * when it is available.
+     *
+     * @param file The local file path
+     * @return The preview image, or a null image if it is not yet
+     * available or the file is not a readable image format.
+     **/
+    QImage preview(const QString &file);
+
+    /**
+     * Cancel generating a preview.
+     *
+     * This should be called when the item for the file is no longer
+     * visible, so that no time is wasted generating the preview.
+     * If the preview has not started to be generated yet, then it is
+     * removed from the thread pool's queue.  If it has already started,
+     * it will still be cached when it is available but no signal will
+     * be emitted.
+     *
+     * @param file The local file path
+     **/
+    void cancel(const QString &file);
+
+    /**
+     * Cancel generating previews for all files except those specified.
+     *
+     * This can be called when a view is scrolled, with the files that
+     * are now visible.
+     *
+     * @param files The local file paths
+     **/
+    void setVisibleFiles(const QStringList &files);
+
+    /**
+     * Remove the preview for a file from the cache, for example
+     * if the file has been changed.  If the preview is waiting to be
+     * generated, then it is removed from the thread pool's queue and
+     * will be generated again when it is next requested.  If it is
+     * being generated at the moment, then that result is not used and
+     * it is generated again.
+     *
+     * @param file The local file path
+     **/
+    void invalidate(const QString &file);
+
+signals:
+    /**
+     * A preview has been generated.
+     *
+     * @param file The local file path
+     * @param image The preview image, or a null image if the file
+     * could not be read.
+     **/
+    void previewReady(const QString &file, const QImage &image);
+
+private:
+    friend class ImagePreviewJob;
+    void previewDone(const QString &file, const QImage &image, const QSize &size, bool skipped);
+    bool takeJob(const QSharedPointer<ImagePreviewJob> &job);
+
+private:
+    QSize mPreviewSize;
+    QThreadPool *mThreadPool;
+    QCache<QString, QImage> mCache;
+    QHash<QString, QSharedPointer<ImagePreviewJob> > mPending;
+    QSharedPointer<ImagePreviewShared> mShared;
+};
+
+#endif							// IMAGEPREVIEWPROVIDER_H
@@ -0,0 +1,196 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include "imageprobe.h"
+
+#include <qthreadpool.h>
+#include <qrunnable.h>
+#include <qmutex.h>
+#include <qatomic.h>
+#include <qfile.h>
+#include <qmimedatabase.h>
+#include <qmimetype.h>
+
+#include "imageformattable.h"
+#include "libkfdialog_logging.h"
+
+
+// State shared between the probe and its worker jobs, which may
+// still be queued or running after the probe has been deleted.
+// Results are only posted back while the probe still exists.
+struct ImageProbeShared
+{
+    QMutex mutex;					// protects probe below
+    ImageProbe *probe;					// null when probe deleted
+    QAtomicInt cancelled;				// set if probe cancelled
+    int maxHeaderSize;					// bytes to read from file
+};
+
+
+class ImageProbeJob : public QRunnable
+{
+public:
+    ImageProbeJob(const QSharedPointer<ImageProbeShared> &shared, const QString &file)
+        : mShared(shared),
+          mFile(file)						{}
+
+    void run() override;
+
+private:
+    QSharedPointer<ImageProbeShared> mShared;
+    QString mFile;
+};
+
+
+static QString probeFile(const QString &file, int maxHeaderSize)
+{
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly)) return (QString());
+    const QByteArray header = f.read(maxHeaderSize);
+    f.close();
+    if (header.isEmpty()) return (QString());
+
+    // QMimeDatabase is thread safe, see its API documentation
+    const QMimeType mime = QMimeDatabase().mimeTypeForData(header);
+    const ImageFormatTable *table = ImageFormatTable::instance();
+
+    // The detected type may be a specialisation of a readable type,
+    // for example a camera raw format which is a TIFF file.
+    const ImageFormatTable::Format *fmt = table->formatForMimeName(mime.name());
+    if (fmt==nullptr)
+    {
+        const QStringList ancestors = mime.allAncestors();
+        for (const QString &ancestor : ancestors)
+        {
+            fmt = table->formatForMimeName(ancestor);
+            if (fmt!=nullptr) break;
+        }
+    }
+
+    if (fmt==nullptr || !(fmt->capabilities & ImageFormatTable::CanRead)) return (QString());
+    return (fmt->mimeName);
+}
+
+
+void ImageProbeJob::run()
+{
+    QString mimeName;
+    if (!mShared->cancelled.loadAcquire()) mimeName = probeFile(mFile, mShared->maxHeaderSize);
+
+    QMutexLocker locker(&mShared->mutex);
+    ImageProbe *probe = mShared->probe;
+    if (probe==nullptr) return;				// probe has gone away
+
+    const QString file = mFile;
+    QMetaObject::invokeMethod(probe, [probe, file, mimeName]() { probe->fileDone(file, mimeName); }, Qt::QueuedConnection);
+}
+
+
+ImageProbe::ImageProbe(QObject *pnt)
+    : QObject(pnt)
+{
+    mMaxHeaderSize = 4096;
+    mThreadPool = QThreadPool::globalInstance();
+    mRemaining = 0;
+}
+
+
+ImageProbe::~ImageProbe()
+{
+    if (mShared.isNull()) return;			// never started
+
+    mShared->cancelled.storeRelease(1);
+    QMutexLocker locker(&mShared->mutex);
+    mShared->probe = nullptr;				// no more results wanted
+}
+
+
+void ImageProbe::setMaxHeaderSize(int bytes)
+{
+    mMaxHeaderSize = qMax(bytes, 16);
+}
+
+
+void ImageProbe::setThreadPool(QThreadPool *pool)
+{
+    mThreadPool = pool;
+}
+
+
+bool ImageProbe::isRunning() const
+{
+    return (mRemaining>0);
+}
+
+
+void ImageProbe::start(const QStringList &files)
+{
+    if (isRunning())
+    {
+        qCWarning(LIBKFDIALOG_LOG) << "probe already running";
+        return;
+    }
+
+    if (files.isEmpty())
+    {
+        QMetaObject::invokeMethod(this, &ImageProbe::finished, Qt::QueuedConnection);
+        return;
+    }
+
+    // Build the format table now, so that the jobs do not all
+    // try to build it at the same time.
+    ImageFormatTable::instance();
+
+    // Any jobs from a previous cancelled run keep their own shared
+    // state, so a new one is used for this run.
+    if (!mShared.isNull())
+    {
+        QMutexLocker locker(&mShared->mutex);
+        mShared->probe = nullptr;
+    }
+
+    mShared.reset(new ImageProbeShared);
+    mShared->probe = this;
+    mShared->maxHeaderSize = mMaxHeaderSize;
+
+    qCDebug(LIBKFDIALOG_LOG) << "probing" << files.count() << "files";
+    mRemaining = files.count();
+    for (const QString &file : files) mThreadPool->start(new ImageProbeJob(mShared, file));
+}
+
+
+void ImageProbe::cancel()
+{
+    if (!isRunning()) return;
+    qCDebug(LIBKFDIALOG_LOG) << "cancelled with" << mRemaining << "remaining";
+    mShared->cancelled.storeRelease(1);
+}
+
+
+void ImageProbe::fileDone(const QString &file, const QString &mimeName)
+{
+    if (mRemaining==0) return;				// not expecting any more
+    if (!mShared->cancelled.loadAcquire()) emit probed(file, mimeName);
+
+    --mRemaining;
+    if (mRemaining==0) emit finished();
+}
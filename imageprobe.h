@@ -0,0 +1,151 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#ifndef IMAGEPROBE_H
+#define IMAGEPROBE_H
+
+#include <qobject.h>
+#include <qstringlist.h>
+#include <qsharedpointer.h>
+
+#include "libkfdialogcore_export.h"
+
+class QThreadPool;
+struct ImageProbeShared;
+
+
+/**
+ * @short Classify a batch of image files by their content.
+ *
+ * This is intended for use when a large number of files need to be
+ * classified, for example when importing a directory of scanned images.
+ * Only a small header prefix of each file is read, and it is matched
+ * against the magic data of the MIME types that can be read by
+ * QImageReader.  The files are read in parallel using a thread pool,
+ * and the results are reported as each file is done.
+ *
+ * @code
+ * ImageProbe *probe = new ImageProbe(this);
+ * connect(probe, &ImageProbe::probed, this, &MyImporter::slotFileProbed);
+ * connect(probe, &ImageProbe::finished, probe, &QObject::deleteLater);
+ * probe->start(files);
+ * @endcode
+ *
+ * @see ImageFormatTable
+ * @author Jonathan Marten
+ **/
+
+class LIBKFDIALOGCORE_EXPORT ImageProbe : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param pnt Parent object
+     **/
+    explicit ImageProbe(QObject *pnt = nullptr);
+
+    /**
+     * Destructor.
+     *
+     * If a probe is in progress then it is cancelled.
+     **/
+    ~ImageProbe() override;
+
+    /**
+     * Set the maximum amount of data read from each file.
+     *
+     * The default is 4096 bytes, which is sufficient for the magic
+     * data of all common image formats.
+     *
+     * @param bytes The maximum number of bytes to read
+     * @note This must be set before @c start() is called.
+     **/
+    void setMaxHeaderSize(int bytes);
+
+    /**
+     * Set the thread pool to be used.
+     *
+     * If this is not set then the global thread pool is used.
+     *
+     * @param pool The thread pool
+     * @note This must be set before @c start() is called.
+     **/
+    void setThreadPool(QThreadPool *pool);
+
+    /**
+     * Start probing a list of files.
+     *
+     * The @c probed() signal is emitted for each file as it is done,
+     * in no particular order, and then the @c finished() signal is
+     * emitted when all of them are done.
+     *
+     * @param files The files to probe, as local file paths
+     **/
+    void start(const QStringList &files);
+
+    /**
+     * Cancel a probe in progress.
+     *
+     * No further @c probed() signals will be emitted, and the
+     * @c finished() signal will be emitted when any files being
+     * read at the moment have been finished with.
+     **/
+    void cancel();
+
+    /**
+     * Check whether a probe is in progress.
+     *
+     * @return @c true if a probe is in progress
+     **/
+    bool isRunning() const;
+
+signals:
+    /**
+     * A file has been probed.
+     *
+     * @param file The file path
+     * @param mimeName The name of the MIME type detected, or a null
+     * string if the file could not be read or it is not a readable
+     * image format.
+     **/
+    void probed(const QString &file, const QString &mimeName);
+
+    /**
+     * All of the files have been probed, or the probe was cancelled.
+     **/
+    void finished();
+
+private:
+    friend class ImageProbeJob;
+    void fileDone(const QString &file, const QString &mimeName);
+
+private:
+    int mMaxHeaderSize;
+    QThreadPool *mThreadPool;
+    int mRemaining;
+    QSharedPointer<ImageProbeShared> mShared;
+};
+
+#endif							// IMAGEPROBE_H
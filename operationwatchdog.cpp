@@ -0,0 +1,202 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include "operationwatchdog.h"
+
+#include <qthread.h>
+#include <qmutex.h>
+#include <qwaitcondition.h>
+#include <qelapsedtimer.h>
+#include <qatomic.h>
+#include <qcoreapplication.h>
+
+#include "libkfdialog_logging.h"
+
+
+static QAtomicInt sEnabled = 0;
+static QAtomicInt sBudget = 500;
+
+// Nesting depth of operations on the GUI thread.  This is
+// only accessed from that thread, so it needs no protection.
+static int sDepth = 0;
+
+
+// The operation in progress on the GUI thread, as seen
+// by the monitoring thread.  All protected by the mutex.
+struct WatchdogSlot
+{
+    QMutex mutex;
+    QWaitCondition wake;				// to stop the monitor
+    bool stop = false;					// monitor to stop
+    bool active = false;				// operation in progress
+    bool reported = false;				// operation already reported
+    const char *operation = nullptr;
+    QString context;
+    QElapsedTimer timer;
+    OperationWatchdog::Callback callback;
+};
+
+Q_GLOBAL_STATIC(WatchdogSlot, sSlot)
+
+
+class WatchdogThread : public QThread
+{
+protected:
+    void run() override;
+};
+
+static WatchdogThread *sThread = nullptr;
+
+
+void WatchdogThread::run()
+{
+    WatchdogSlot *slot = sSlot();
+    QMutexLocker locker(&slot->mutex);
+    while (!slot->stop)
+    {
+        const int budget = sBudget.load();
+        slot->wake.wait(&slot->mutex, qMax(budget/2, 10));
+        if (slot->stop) break;
+        if (!slot->active || slot->reported) continue;	// nothing to report
+
+        const qint64 elapsed = slot->timer.elapsed();
+        if (elapsed<budget) continue;			// still within budget
+
+        slot->reported = true;
+        const char *operation = slot->operation;
+        const QString context = slot->context;
+        const OperationWatchdog::Callback callback = slot->callback;
+        locker.unlock();				// GUI thread can carry on
+
+        qCWarning(LIBKFDIALOG_LOG) << "operation" << operation << "for" << context << "has blocked for" << elapsed << "ms";
+        if (callback) callback(operation, context, int(elapsed));
+        locker.relock();
+    }
+}
+
+
+static void stopThread()
+{
+    if (sThread==nullptr) return;			// not running
+
+    WatchdogSlot *slot = sSlot();
+    slot->mutex.lock();
+    slot->stop = true;
+    slot->wake.wakeAll();
+    slot->mutex.unlock();
+
+    sThread->wait();
+    delete sThread;
+    sThread = nullptr;
+    slot->stop = false;
+}
+
+
+static bool isGuiThread()
+{
+    const QCoreApplication *app = QCoreApplication::instance();
+    return (app!=nullptr && QThread::currentThread()==app->thread());
+}
+
+
+OperationWatchdog::Scope::Scope(const char *operation, const QString &context)
+    : mActive(false)
+{
+    if (sEnabled.load()==0) return;			// watchdog not enabled
+    if (!isGuiThread()) return;				// only interested in GUI thread
+
+    mActive = true;
+    if (sDepth++>0) return;				// nested within another
+
+    WatchdogSlot *slot = sSlot();
+    QMutexLocker locker(&slot->mutex);
+    slot->operation = operation;
+    slot->context = context;
+    slot->reported = false;
+    slot->active = true;
+    slot->timer.start();
+}
+
+
+OperationWatchdog::Scope::~Scope()
+{
+    if (!mActive) return;				// not being monitored
+    if (--sDepth>0) return;				// still nested
+
+    WatchdogSlot *slot = sSlot();
+    QMutexLocker locker(&slot->mutex);
+    slot->active = false;
+    if (!slot->reported) return;			// finished within budget
+
+    const char *operation = slot->operation;
+    const QString context = slot->context;
+    const qint64 elapsed = slot->timer.elapsed();
+    locker.unlock();
+
+    qCWarning(LIBKFDIALOG_LOG) << "operation" << operation << "for" << context << "took" << elapsed << "ms";
+}
+
+
+void OperationWatchdog::setEnabled(bool on)
+{
+    if (on==isEnabled()) return;			// no change
+
+    if (on)
+    {
+        static bool routineAdded = false;
+        if (!routineAdded)				// stop thread at exit
+        {
+            qAddPostRoutine(stopThread);
+            routineAdded = true;
+        }
+
+        sThread = new WatchdogThread;
+        sThread->setObjectName("OperationWatchdog");
+        sThread->start();
+        sEnabled.store(1);
+    }
+    else
+    {
+        sEnabled.store(0);
+        stopThread();
+    }
+}
+
+
+bool OperationWatchdog::isEnabled()
+{
+    return (sEnabled.load()!=0);
+}
+
+
+void OperationWatchdog::setBudget(int ms)
+{
+    sBudget.store(qMax(ms, 1));
+}
+
+
+void OperationWatchdog::setCallback(const OperationWatchdog::Callback &callback)
+{
+    WatchdogSlot *slot = sSlot();
+    QMutexLocker locker(&slot->mutex);
+    slot->callback = callback;
+}
@@ -0,0 +1,159 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#ifndef OPERATIONWATCHDOG_H
+#define OPERATIONWATCHDOG_H
+
+#include <qstring.h>
+
+#include <functional>
+
+#include "libkfdialogcore_export.h"
+
+
+/**
+ * @short Report library operations which block the GUI thread for too long.
+ *
+ * Some operations done by the library while a dialog is being opened or
+ * closed, such as syncing the config file or loading image plugins, can
+ * occasionally take a long time.  For example, the config file may be on
+ * a slow network mount.  If the watchdog is enabled, then the start and
+ * end of each of those operations done on the GUI thread is marked, and a
+ * monitoring thread reports any operation which has taken longer than
+ * the budget.  The report is logged as a warning in the library's logging
+ * category, and is also passed to a callback if one is set.
+ *
+ * The watchdog is not enabled by default.  When it is enabled, marking
+ * an operation is cheap enough that it can be left enabled in production.
+ * Operations done on other threads are not monitored.
+ *
+ * @code
+ * OperationWatchdog::setBudget(250);
+ * OperationWatchdog::setCallback([](const char *op, const QString &context, int ms)
+ * {
+ *     reportStall(op, context, ms);
+ * });
+ * OperationWatchdog::setEnabled(true);
+ * @endcode
+ *
+ * @author Jonathan Marten
+ **/
+
+class LIBKFDIALOGCORE_EXPORT OperationWatchdog
+{
+public:
+    /**
+     * A function to be called when an operation goes over the budget.
+     *
+     * The parameters are the name of the operation, the context (normally
+     * the object name of the dialog concerned) and the time that it has
+     * taken so far in milliseconds.
+     *
+     * @note The function is called from the monitoring thread, while the
+     * GUI thread is still blocked.  It must not access any widgets, and
+     * must not take any lock that the GUI thread may be holding.
+     **/
+    typedef std::function<void(const char *, const QString &, int)> Callback;
+
+    /**
+     * Marks an operation for as long as it exists.
+     *
+     * Create one on the stack for the duration of the operation.  If the
+     * watchdog is not enabled, or if it is not created on the GUI thread,
+     * then it does nothing.  If operations are nested, then only the
+     * outermost one is monitored.
+     **/
+    class LIBKFDIALOGCORE_EXPORT Scope
+    {
+    public:
+        /**
+         * Constructor.
+         *
+         * @param operation The name of the operation.  This must be a
+         * string literal or otherwise remain valid for the lifetime of
+         * the application.
+         * @param context The context of the operation, normally the
+         * object name of the dialog.
+         **/
+        explicit Scope(const char *operation, const QString &context = QString());
+
+        /**
+         * Destructor.
+         *
+         * Marks the end of the operation.
+         **/
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY(Scope)
+        bool mActive;
+    };
+
+    /**
+     * Enable or disable the watchdog.  This is an application-wide setting,
+     * and the default is @c false.
+     *
+     * Enabling the watchdog starts the monitoring thread, and disabling
+     * it stops the thread.
+     *
+     * @param on Whether the watchdog is to be enabled
+     *
+     * @note This should only be called from the GUI thread, and not
+     * while an operation is in progress.
+     **/
+    static void setEnabled(bool on);
+
+    /**
+     * Check whether the watchdog is enabled.
+     *
+     * @return @c true if the watchdog is enabled
+     **/
+    static bool isEnabled();
+
+    /**
+     * Set the time budget for an operation.  This is an application-wide
+     * setting, and the default is 500 milliseconds.
+     *
+     * An operation which takes longer than this is reported.  It may be
+     * up to half as long again before it is reported, depending on when
+     * the monitoring thread next checks.
+     *
+     * @param ms The time budget, in milliseconds
+     **/
+    static void setBudget(int ms);
+
+    /**
+     * Set a function to be called when an operation goes over the budget.
+     *
+     * The report is logged in any case.  If the operation eventually
+     * finishes, then its total time is also logged.
+     *
+     * @param callback The function to call, or @c nullptr for none
+     * @see Callback
+     **/
+    static void setCallback(const Callback &callback);
+
+private:
+    OperationWatchdog() = delete;
+};
+
+#endif							// OPERATIONWATCHDOG_H
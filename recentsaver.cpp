@@ -24,34 +24,284 @@
 
 #include <qurl.h>
 #include <qfileinfo.h>
+#include <qdiriterator.h>
+#include <qthreadpool.h>
+#include <qrunnable.h>
+#include <qmutex.h>
+#include <qset.h>
+#include <qhash.h>
+#include <qelapsedtimer.h>
+#include <qstandardpaths.h>
 
-#include <krecentdirs.h>
+#include <kconfiggroup.h>
+#include <ksharedconfig.h>
 
+#include "operationwatchdog.h"
 #include "libkfdialog_logging.h"
 
 
+static bool sPrefetch = false;
+
+// The recent locations are stored in exactly the same way as by
+// KRecentDirs, so that they are shared with the KIO file dialogues,
+// but they are accessed directly so that the library does not need
+// KIOFileWidgets.  The functions below follow recentdirs_readList(),
+// KRecentDirs::list() and KRecentDirs::add() in KIO's
+// src/filewidgets/krecentdirs.cpp, and must be kept compatible.
+static const int sMaxRecentDirs = 3;			// MAX_DIR_HISTORY
+
+
+static KConfigGroup recentDirsGroup(const QString &fileClass, QString *key)
+{
+    *key = fileClass;
+    if (key->length()<2 || key->at(0)!=':') *key = QStringLiteral(":default");
+
+    if (key->at(1)==':')				// system-global list
+    {
+        key->remove(0, 2);
+        return (KConfigGroup(KSharedConfig::openConfig(QStringLiteral("krecentdirsrc")), QString()));
+    }
+
+    key->remove(0, 1);					// application-global list
+    return (KConfigGroup(KSharedConfig::openConfig(), QStringLiteral("Recent Dirs")));
+}
+
+
+static QStringList recentDirsList(const QString &fileClass, bool withDefault = true)
+{
+    QString key;
+    const KConfigGroup grp = recentDirsGroup(fileClass, &key);
+    QStringList result = grp.readPathEntry(key, QStringList());
+    if (result.isEmpty() && withDefault) result.append(QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation));
+    return (result);
+}
+
+
+static void recentDirsAdd(const QString &fileClass, const QString &dir)
+{
+    QString key;
+    KConfigGroup grp = recentDirsGroup(fileClass, &key);
+    QStringList result = grp.readPathEntry(key, QStringList());
+    result.removeAll(dir);
+    result.prepend(dir);				// most recent first
+    while (result.count()>sMaxRecentDirs) result.removeLast();
+    grp.writePathEntry(key, result);
+    grp.sync();
+}
+
+// Directories currently being prefetched, so that the
+// same one is not read by more than one thread at once.
+static QMutex sPrefetchMutex;
+static QSet<QString> sPrefetching;
+
+
+class RecentPrefetchJob : public QRunnable
+{
+public:
+    explicit RecentPrefetchJob(const QString &dir)
+        : mDir(dir)						{}
+
+    void run() override;
+
+private:
+    QString mDir;
+};
+
+
+void RecentPrefetchJob::run()
+{
+    // Reading the directory and the status of each entry warms the
+    // operating system's directory and inode caches, so that when
+    // the file dialogue lists the same directory it does not have
+    // to wait for the disk.  There is no need to use the results.
+    // The number of entries is limited in case the directory is
+    // very large.
+    int count = 0;
+    QDirIterator it(mDir, QDir::AllEntries|QDir::Hidden|QDir::System|QDir::NoDotAndDotDot);
+    while (it.hasNext() && count<10000)
+    {
+        it.next();
+        it.fileInfo().size();				// forces a stat() call
+        ++count;
+    }
+
+    qCDebug(LIBKFDIALOG_LOG) << "prefetched" << count << "entries from" << mDir;
+    QMutexLocker locker(&sPrefetchMutex);
+    sPrefetching.remove(mDir);
+}
+
+
 RecentSaver::RecentSaver(const QString &fileClass)
 {
     Q_ASSERT(!fileClass.isEmpty());
     mRecentClass = fileClass;
     if (!mRecentClass.startsWith(':')) mRecentClass.prepend(':');
+
+    if (sPrefetch) prefetch();
+}
+
+
+void RecentSaver::setPrefetchDefault(bool on)
+{
+    sPrefetch = on;
+}
+
+
+// Remote locations are saved in the recent list as URL strings,
+// while local locations are saved as plain paths.
+static bool isRemote(const QString &dir)
+{
+    return (!dir.startsWith('/') && dir.contains(QLatin1String(":/")));
+}
+
+
+static void startPrefetch(const QString &dir)
+{
+    if (dir.isEmpty()) return;				// no saved location
+    if (isRemote(dir)) return;				// only for local directories
+
+    QMutexLocker locker(&sPrefetchMutex);
+    if (sPrefetching.contains(dir)) return;		// already being read
+    sPrefetching.insert(dir);
+    QThreadPool::globalInstance()->start(new RecentPrefetchJob(dir));
+}
+
+
+void RecentSaver::prefetch()
+{
+    // Only locations which have actually been saved are considered,
+    // not the default if there is no history.  Remote locations cannot
+    // be prefetched, so the most recent local location is used.
+    const QStringList dirs = recentDirsList(mRecentClass, false);
+    for (const QString &dir : dirs)
+    {
+        if (dir.isEmpty() || isRemote(dir)) continue;
+        startPrefetch(dir);
+        return;
+    }
+}
+
+
+// The result of checking whether a remote location is reachable
+// is cached, so that the check is only done occasionally and the
+// GUI thread never has to wait for it.  This is only accessed from
+// the GUI thread, where the checks run.  The check itself is
+// provided by the application or by libkfdialog, so that this
+// library does not need to link with KIO.
+struct Reachability
+{
+    bool reachable;					// result of last check
+    bool checking;					// check in progress
+    qint64 checkedAt;					// time of last check
+};
+
+static QHash<QString, Reachability> sReachability;
+static QElapsedTimer sReachabilityClock;
+
+static const qint64 sReachableTimeout = 5*60*1000;	// recheck if reachable
+static const qint64 sUnreachableTimeout = 30*1000;	// recheck if not reachable
+static const qint64 sCheckTimeout = 60*1000;		// give up on check
+
+static RecentSaver::ReachabilityCheck sReachabilityCheck;
+
+
+void RecentSaver::setReachabilityCheck(const RecentSaver::ReachabilityCheck &check)
+{
+    sReachabilityCheck = check;
+    sReachability.clear();				// previous results are stale
+}
+
+
+static void setReachable(const QString &dir, bool reachable)
+{
+    if (!sReachabilityClock.isValid()) sReachabilityClock.start();
+    sReachability[dir] = Reachability { reachable, false, sReachabilityClock.elapsed() };
+}
+
+
+static bool isReachable(const QString &dir)
+{
+    if (!sReachabilityCheck) return (false);		// no way to check
+    if (!sReachabilityClock.isValid()) sReachabilityClock.start();
+    const qint64 now = sReachabilityClock.elapsed();
+
+    const QHash<QString, Reachability>::const_iterator it = sReachability.constFind(dir);
+    if (it!=sReachability.constEnd())
+    {
+        const Reachability &r = it.value();
+        // A check in progress is given a limited time, in case it never
+        // finishes; for example, if there is no event loop running.
+        const qint64 timeout = (r.checking ? sCheckTimeout : (r.reachable ? sReachableTimeout : sUnreachableTimeout));
+        if ((now-r.checkedAt)<timeout) return (r.reachable);
+    }
+
+    // Not known or out of date, so start a new check.  Until that
+    // completes the previous result, if any, continues to be used.
+    const bool wasReachable = (it!=sReachability.constEnd() && it.value().reachable);
+    sReachability[dir] = Reachability { wasReachable, true, now };
+
+    qCDebug(LIBKFDIALOG_LOG) << "checking" << dir;
+    sReachabilityCheck(QUrl(dir), [dir](bool reachable)
+    {
+        qCDebug(LIBKFDIALOG_LOG) << "checked" << dir << "reachable" << reachable;
+        setReachable(dir, reachable);
+    });
+
+    // The check may have completed already, if it did not need to wait
+    return (sReachability.value(dir).reachable);
+}
+
+
+QString RecentSaver::resolveRecentDir(bool allowRemote)
+{
+    // Use the most recent location which is usable.  A remote location
+    // is only used if it is known to be reachable, otherwise an older
+    // local location is used if there is one.
+    const QStringList dirs = recentDirsList(mRecentClass);
+    for (const QString &dir : dirs)
+    {
+        if (dir.isEmpty()) continue;
+        if (isRemote(dir))
+        {
+            if (!allowRemote) continue;			// caller needs a local path
+            if (!isReachable(dir)) continue;		// not reachable just now
+        }
+
+        mRecentDir = dir;
+        if (!mRecentDir.endsWith('/')) mRecentDir += '/';
+        if (sPrefetch) startPrefetch(mRecentDir);
+        return (mRecentDir);
+    }
+
+    mRecentDir.clear();					// no usable location
+    return (mRecentDir);
 }
 
 
 QUrl RecentSaver::recentUrl(const QString &suggestedName)
 {
-    // QUrl::fromLocalFile("") -> QUrl(), so no need for null test here
-    return (QUrl::fromLocalFile(recentPath(suggestedName)));
+    OperationWatchdog::Scope scope("RecentSaver::recentUrl", mRecentClass);
+    const QString dir = resolveRecentDir(true);
+    if (dir.isEmpty()) return (QUrl());			// no saved history
+    if (!isRemote(dir))
+    {
+        QString recentPath = dir;
+        if (!suggestedName.isEmpty()) recentPath += suggestedName;
+        return (QUrl::fromLocalFile(recentPath));
+    }
+
+    QUrl url(dir);
+    if (!suggestedName.isEmpty()) url.setPath(url.path()+suggestedName);
+    qCDebug(LIBKFDIALOG_LOG) << "for" << mRecentClass << "url" << dir << "->" << url;
+    return (url);
 }
 
 
 QString RecentSaver::recentPath(const QString &suggestedName)
 {
-    mRecentDir = KRecentDirs::dir(mRecentClass);
-    if (!mRecentDir.isEmpty() && !mRecentDir.endsWith('/')) mRecentDir += '/';
-
-    QString recentDir = mRecentDir;
-    if (!suggestedName.isEmpty()) recentDir += suggestedName;
+    OperationWatchdog::Scope scope("RecentSaver::recentPath", mRecentClass);
+    QString recentDir = resolveRecentDir(false);
+    if (!recentDir.isEmpty() && !suggestedName.isEmpty()) recentDir += suggestedName;
     qCDebug(LIBKFDIALOG_LOG) << "for" << mRecentClass << "dir" << mRecentDir << "->" << recentDir;
     return (recentDir);
 }
@@ -60,19 +310,33 @@ QString RecentSaver::recentPath(const QString &suggestedName)
 void RecentSaver::save(const QUrl &url)
 {
     if (!url.isValid()) return;				// didn't get a valid entry
-    if (!url.isLocalFile()) return;			// can only save local dirs
-    save(url.path());					// save the local path
+    OperationWatchdog::Scope scope("RecentSaver::save", mRecentClass);
+    if (url.isLocalFile())
+    {
+        save(url.path());				// save the local path
+        return;
+    }
+
+    // The password is never saved, because the config file is plain text
+    QString rd = url.adjusted(QUrl::RemoveFilename|QUrl::RemoveQuery|QUrl::RemoveFragment|QUrl::RemovePassword).toString();
+    if (!rd.endsWith('/')) rd += '/';			// ensure saved as directory
+    if (rd==mRecentDir) return;				// nothing new, no need to save
+
+    qCDebug(LIBKFDIALOG_LOG) << "for" << mRecentClass << "saving" << rd;
+    setReachable(rd, true);				// it has just been used
+    recentDirsAdd(mRecentClass, rd);
 }
 
 
 void RecentSaver::save(const QString &path)
 {
     if (path.isEmpty()) return;				// didn't get a valid entry
+    OperationWatchdog::Scope scope("RecentSaver::save", mRecentClass);
 
     QString rd = QFileInfo(path).path();		// just take directory path
     if (!rd.endsWith('/')) rd += '/';			// ensure saved as directory
     if (rd==mRecentDir) return;				// nothing new, no need to save
 
     qCDebug(LIBKFDIALOG_LOG) << "for" << mRecentClass << "saving" << rd;
-    KRecentDirs::add(mRecentClass, rd);
+    recentDirsAdd(mRecentClass, rd);
 }
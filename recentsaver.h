@@ -23,8 +23,10 @@
 #ifndef RECENTSAVER_H
 #define RECENTSAVER_H
 
+#include <functional>
+
 #include <qstring.h>
-#include "libkfdialog_export.h"
+#include "libkfdialogcore_export.h"
 
 class QUrl;
 
@@ -32,9 +34,12 @@ class QUrl;
 /**
  * @short A helper to look up and save recent locations for a file dialogue.
  *
- * Saving the recent locations is handled by @c KRecentDirs, but a bit of code
- * is needed before and after each file dialogue to look up the appropriate
- * recent location and save it afterwards.  This class automates that.
+ * The recent locations are saved in the same way as by @c KRecentDirs, so
+ * that they are shared with KDE file dialogues, but a bit of code is needed
+ * before and after each file dialogue to look up the appropriate recent
+ * location and save it afterwards.  This class automates that.  It is
+ * in the core library and only needs KConfig, so it can also be used
+ * by applications which do not use the KIO file widgets.
  *
  * For a simple use of the static QFileDialog functions, simply create and
  * use a RecentSaver like this:
@@ -50,12 +55,29 @@ class QUrl;
  * }
  * @endcode
  *
+ * Remote locations (for example on an SFTP or SMB share) are also saved
+ * if the file dialogue supports them.  A remote location is only offered
+ * by @c recentUrl() if it is known to be reachable; whether it is
+ * reachable is checked in the background and the result is cached for
+ * a while, so the application never has to wait for the network.  If a
+ * remote location is not offered, then the most recent local location
+ * is used instead.  @c recentPath() only ever returns a local location.
+ * The check never prompts the user, and a password in a remote URL
+ * is never saved.
+ *
+ * The core library does not itself know how to check a remote location,
+ * so that it does not need to link with KIO.  The check is provided by
+ * libkfdialog, which installs it automatically when it is loaded (see
+ * @c RemoteReachability), or by the application calling
+ * @c setReachabilityCheck().  If there is no check, then remote
+ * locations are never offered.
+ *
  * @see KRecentDirs
  * @see QFileDialog
  * @author Jonathan Marten
  **/
 
-class LIBKFDIALOG_EXPORT RecentSaver
+class LIBKFDIALOGCORE_EXPORT RecentSaver
 {
 public:
     /**
@@ -74,6 +96,56 @@ public:
      **/
     ~RecentSaver() = default;
 
+    /**
+     * Set the default option of whether the recent location is prefetched.
+     * This is an application-wide setting which takes effect for any
+     * RecentSaver subsequently created.  The default is @c false.
+     *
+     * If this option is set, then when a RecentSaver is created and
+     * when @c recentUrl() or @c recentPath() is called, the recent
+     * location is read in the background.  This means that the
+     * operating system will have cached the directory contents by
+     * the time that the file dialogue needs to list them, so that
+     * the dialogue can appear already populated.
+     *
+     * @param on Whether the recent location is to be prefetched
+     * @see prefetch()
+     **/
+    static void setPrefetchDefault(bool on);
+
+    /**
+     * A function to check whether a remote location is reachable.
+     *
+     * It is called in the GUI thread with the location to check, and must
+     * not block.  When the check is complete it must call the @p done
+     * function in the GUI thread, with the result.  It may do so before
+     * returning if the result is known immediately.  The check must never
+     * prompt the user, and should give up after a reasonable time.
+     **/
+    typedef std::function<void (const QUrl &url, const std::function<void (bool reachable)> &done)> ReachabilityCheck;
+
+    /**
+     * Set the function used to check whether a remote location is
+     * reachable.  This is an application-wide setting.  Any results
+     * from a previous check function are discarded.
+     *
+     * @param check The check function, or an empty function to not
+     * offer remote locations at all
+     **/
+    static void setReachabilityCheck(const ReachabilityCheck &check);
+
+    /**
+     * Start reading the recent location in the background.
+     *
+     * This is done automatically if the option is set by
+     * @c setPrefetchDefault(), but can also be called explicitly
+     * if the file dialogue is known to be needed soon.  The most
+     * recent local location in the saved history is read; remote
+     * locations are skipped.  Nothing is done if there is no saved
+     * local location, or if it is already being read.
+     **/
+    void prefetch();
+
     /**
      * Resolve the saved recent location (if there is one) and a suggested
      * file name (if required) into a URL to pass to a @c QFileDialog
@@ -83,6 +155,10 @@ public:
      * if none is required.
      * @return The resolved URL, or a null URL if there is no saved
      * history.
+     * @note A remote location is not returned the first time that
+     * it is used after the application starts, because its reachability
+     * will not be known yet.  It will be returned as soon as the
+     * background check has found that it is reachable.
      **/
     QUrl recentUrl(const QString &suggestedName = QString());
 
@@ -95,6 +171,7 @@ public:
      * if none is required.
      * @return The resolved file path, or a null string if there is no
      * saved history.
+     * @note Only local locations are returned.
      **/
     QString recentPath(const QString &suggestedName = QString());
 
@@ -112,6 +189,9 @@ public:
      **/
     void save(const QString &path);
 
+private:
+    QString resolveRecentDir(bool allowRemote);
+
 private:
     QString mRecentClass;
     QString mRecentDir;
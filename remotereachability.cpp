@@ -0,0 +1,63 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#include "remotereachability.h"
+
+#include <qurl.h>
+#include <qtimer.h>
+#include <qcoreapplication.h>
+
+#include <kio/statjob.h>
+
+#include "recentsaver.h"
+#include "libkfdialog_logging.h"
+
+
+static const int sCheckTimeout = 60*1000;		// give up on check
+
+
+static void checkReachable(const QUrl &url, const std::function<void (bool)> &done)
+{
+    qCDebug(LIBKFDIALOG_LOG) << "stat" << url;
+    KIO::StatJob *job = KIO::stat(url, KIO::HideProgressInfo);
+    // This is a background check, so it must never interact with the
+    // user; for example, by asking for a password.
+    job->setUiDelegate(nullptr);
+    job->addMetaData(QStringLiteral("no-auth-prompt"), QStringLiteral("true"));
+    QObject::connect(job, &KJob::result, [done](KJob *job)
+    {
+        done(job->error()==0);
+    });
+    // If the check takes too long, then give up and treat as not reachable
+    QTimer::singleShot(sCheckTimeout, job, [job]() { job->kill(KJob::EmitResult); });
+}
+
+
+void RemoteReachability::install()
+{
+    RecentSaver::setReachabilityCheck(&checkReachable);
+}
+
+
+// When linked as a shared library this is always done at startup.
+// A static library only includes this if install() is referenced.
+Q_COREAPP_STARTUP_FUNCTION(RemoteReachability::install)
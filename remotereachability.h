@@ -0,0 +1,57 @@
+/************************************************************************
+ *									*
+ *  This source file is part of libkfdialog, a helper library for	*
+ *  implementing QtWidgets-based dialogues under KDE Frameworks or	*
+ *  standalone.  Originally developed as part of Kooka, a KDE		*
+ *  scanning/OCR application.						*
+ *									*
+ *  The library is free software; you can redistribute and/or		*
+ *  modify it under the terms of the GNU General Public License		*
+ *  version 2 or (at your option) any later version, as published	*
+ *  by the Free Software Foundation and appearing in the file		*
+ *  COPYING included in the packaging of this library, or at		*
+ *  http://www.gnu.org/licenses/gpl.html				*
+ *									*
+ *  Copyright (C) 2016-2021 Jonathan Marten				*
+ *                          <jjm AT keelhaul DOT me DOT uk>		*
+ *			    and Kooka authors/contributors		*
+ *									*
+ *  Home page:  https://github.com/martenjj/libkfdialog			*
+ *									*
+ ************************************************************************/
+
+#ifndef REMOTEREACHABILITY_H
+#define REMOTEREACHABILITY_H
+
+#include "libkfdialog_export.h"
+
+
+/**
+ * @short Check whether a remote recent location is reachable, using KIO.
+ *
+ * This provides the reachability check for @c RecentSaver.  It is in
+ * this library, instead of in the core library with RecentSaver, so that
+ * the core library does not need to link with KIO.
+ *
+ * The check is a @c KIO::stat() of the location which never interacts
+ * with the user (for example, by asking for a password), and which is
+ * abandoned if it does not complete within a minute.
+ *
+ * If libkfdialog is a shared library, then the check is installed
+ * automatically when the application starts.  If it is a static library,
+ * then the application should call @c install() itself.
+ *
+ * @see RecentSaver::setReachabilityCheck()
+ * @author Jonathan Marten
+ **/
+
+namespace RemoteReachability
+{
+    /**
+     * Install the KIO reachability check for @c RecentSaver.
+     * It is safe to call this more than once.
+     **/
+    LIBKFDIALOG_EXPORT void install();
+}
+
+#endif							// REMOTEREACHABILITY_H